@@ -0,0 +1,231 @@
+// Q16.16 (fixed_point.h) against float for the sensing and control kernels:
+// probe calibration, the EMA filter, a PI update, a rollup mean and a bare
+// division.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude bench/fixed_point_bench.cpp -o fixed_point_bench
+//   ./fixed_point_bench [--filter Fixed]
+//
+// On the ESP32 the same file is the whole sketch, with results on the
+// serial port at 115200. That's the comparison that matters: its FPU has
+// no single-instruction divide and float is off limits in ISRs.
+// On x86 hosts float division is one instruction, so the Fixed16 mean and
+// division (a 64-bit integer divide) come out slower there.
+//
+//   export PLATFORMIO_BUILD_FLAGS="-I$PWD/include"
+//   pio ci bench/fixed_point_bench.cpp -b esp32dev -O framework=arduino --build-dir /tmp/bench -k
+//   pio run -d /tmp/bench -t upload --upload-port /dev/ttyUSB0
+//
+// Before timing, the largest difference from a double reference is printed
+// for each fixed-point kernel.
+
+#include "microbench.h"
+
+#include <math.h>
+
+#include "fixed_point.h"
+
+static const int32_t dryCounts = 4095;
+static const int32_t wetCounts = 0;
+
+static float calibrateFloat(uint32_t reading) {
+  float percent = ((int32_t)reading - dryCounts) * 100.0f / (wetCounts - dryCounts);
+  return percent < 0 ? 0 : percent > 100 ? 100 : percent;
+}
+
+static Fixed16 calibrateFixed(uint32_t reading) {
+  return Fixed16::ratio(((int64_t)reading - dryCounts) * 100, wetCounts - dryCounts)
+      .clamp(Fixed16::fromInt(0), Fixed16::fromInt(100));
+}
+
+// Gains per 1 s tick; output is pump duty 0..1
+static const float kpFloat = 0.08f;
+static const float kiFloat = 0.004f;
+static constexpr Fixed16 kpFixed = Fixed16::fromFloat(0.08f);
+static constexpr Fixed16 kiFixed = Fixed16::fromFloat(0.004f);
+
+struct PiFloat {
+  float integral;
+  float update(float setpoint, float measured) {
+    float error = setpoint - measured;
+    integral += kiFloat * error;
+    integral = integral < 0 ? 0 : integral > 1 ? 1 : integral;
+    float out = kpFloat * error + integral;
+    return out < 0 ? 0 : out > 1 ? 1 : out;
+  }
+};
+
+struct PiFixed {
+  Fixed16 integral;
+  Fixed16 update(Fixed16 setpoint, Fixed16 measured) {
+    Fixed16 zero = Fixed16::fromInt(0);
+    Fixed16 one = Fixed16::fromInt(1);
+    Fixed16 error = setpoint - measured;
+    integral = (integral + kiFixed * error).clamp(zero, one);
+    return (kpFixed * error + integral).clamp(zero, one);
+  }
+};
+
+static void reportAccuracy() {
+  double worst = 0;
+  for (uint32_t raw = 0; raw <= 4095; raw++) {
+    double exact = (double)((int32_t)raw - dryCounts) * 100 / (wetCounts - dryCounts);
+    worst = fmax(worst, fabs(calibrateFixed(raw).toFloat() - exact));
+  }
+  printf("calibration: max error %.6f %%\n", worst);
+
+  worst = 0;
+  double emaExact = 50;
+  Fixed16 ema = Fixed16::fromInt(50);
+  Fixed16 weight = Fixed16::fromFloat(0.2f);
+  for (uint32_t i = 0; i < 100000; i++) {
+    uint32_t raw = (i * 2654435761u) >> 20;   // 0..4095, scattered
+    double input = (double)((int32_t)raw - dryCounts) * 100 / (wetCounts - dryCounts);
+    emaExact += (input - emaExact) * weight.toFloat();
+    ema += (calibrateFixed(raw) - ema) * weight;
+    worst = fmax(worst, fabs(ema.toFloat() - emaExact));
+  }
+  printf("EMA (weight 0.2, 100k steps): max error %.6f %%\n", worst);
+
+  worst = 0;
+  PiFixed pi = { Fixed16::fromInt(0) };
+  double integral = 0;
+  for (uint32_t i = 0; i < 100000; i++) {
+    int measured = 30 + (int)((i / 50) % 20);
+    double error = 40 - measured;
+    integral = fmin(1, fmax(0, integral + kiFixed.toFloat() * error));
+    double out = fmin(1, fmax(0, kpFixed.toFloat() * error + integral));
+    Fixed16 fixedOut = pi.update(Fixed16::fromInt(40), Fixed16::fromInt(measured));
+    worst = fmax(worst, fabs(fixedOut.toFloat() - out));
+  }
+  printf("PI (100k steps): max output error %.6f\n", worst);
+}
+
+static void BM_CalibrateFloat(BenchState& state) {
+  uint32_t raw = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(calibrateFloat(raw));
+    raw = (raw + 37) & 4095;
+  }
+}
+BENCHMARK(BM_CalibrateFloat);
+
+static void BM_CalibrateFixed(BenchState& state) {
+  uint32_t raw = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(calibrateFixed(raw));
+    raw = (raw + 37) & 4095;
+  }
+}
+BENCHMARK(BM_CalibrateFixed);
+
+static void BM_EmaFloat(BenchState& state) {
+  float ema = 50;
+  float input = 0;
+  while (state.keepRunning()) {
+    ema += (input - ema) * 0.2f;
+    input = input >= 100 ? 0 : input + 1.5f;
+    doNotOptimize(ema);
+  }
+}
+BENCHMARK(BM_EmaFloat);
+
+static void BM_EmaFixed(BenchState& state) {
+  static constexpr Fixed16 weight = Fixed16::fromFloat(0.2f);
+  static constexpr Fixed16 step = Fixed16::fromFloat(1.5f);
+  Fixed16 ema = Fixed16::fromInt(50);
+  Fixed16 input = Fixed16::fromInt(0);
+  while (state.keepRunning()) {
+    ema += (input - ema) * weight;
+    input = input >= Fixed16::fromInt(100) ? Fixed16::fromInt(0) : input + step;
+    doNotOptimize(ema);
+  }
+}
+BENCHMARK(BM_EmaFixed);
+
+static void BM_PiFloat(BenchState& state) {
+  PiFloat pi = { 0 };
+  uint32_t i = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(pi.update(40, (float)(30 + (i++ & 15))));
+  }
+}
+BENCHMARK(BM_PiFloat);
+
+static void BM_PiFixed(BenchState& state) {
+  PiFixed pi = { Fixed16::fromInt(0) };
+  uint32_t i = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(pi.update(Fixed16::fromInt(40), Fixed16::fromInt(30 + (i++ & 15))));
+  }
+}
+BENCHMARK(BM_PiFixed);
+
+// Rollup bucket mean: sum of percents over up to a day of samples
+static void BM_MeanFloat(BenchState& state) {
+  uint32_t sum = 123456;
+  uint32_t count = 3000;
+  while (state.keepRunning()) {
+    doNotOptimize((float)sum / count);
+    sum += 41;
+    count += 1;
+  }
+}
+BENCHMARK(BM_MeanFloat);
+
+static void BM_MeanFixed(BenchState& state) {
+  uint32_t sum = 123456;
+  uint32_t count = 3000;
+  while (state.keepRunning()) {
+    doNotOptimize(Fixed16::ratio(sum, count));
+    sum += 41;
+    count += 1;
+  }
+}
+BENCHMARK(BM_MeanFixed);
+
+static void BM_DivideFloat(BenchState& state) {
+  float a = 1234.5f;
+  float b = 3.25f;
+  while (state.keepRunning()) {
+    doNotOptimize(a / b);
+    b += 0.001f;
+  }
+}
+BENCHMARK(BM_DivideFloat);
+
+static void BM_DivideFixed(BenchState& state) {
+  Fixed16 a = Fixed16::fromFloat(1234.5f);
+  Fixed16 b = Fixed16::fromFloat(3.25f);
+  Fixed16 step = Fixed16::fromRaw(66);
+  while (state.keepRunning()) {
+    doNotOptimize(a / b);
+    b += step;
+  }
+}
+BENCHMARK(BM_DivideFixed);
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  reportAccuracy();
+  char name[] = "fixed_point_bench";
+  char* argv[] = { name, nullptr };
+  runBenchmarks(1, argv);
+}
+
+void loop() {
+  delay(1000);
+}
+
+#else
+
+int main(int argc, char** argv) {
+  reportAccuracy();
+  return runBenchmarks(argc, argv);
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Target benchmark: Arduino's digitalWrite()/digitalRead() against the
+// register path in gpio.h, in CPU cycles per call, for the per-tick I/O:
+// relay and buzzer writes and the three button reads.
+//
+// The comparison only means something on the chip, so this file is an
+// ESP32 sketch (the native build's GPIO goes through the HAL either way):
+//
+//   export PLATFORMIO_BUILD_FLAGS="-I$PWD/include"
+//   pio ci bench/gpio_bench.cpp -b esp32dev -O framework=arduino --build-dir /tmp/bench -k
+//   pio run -d /tmp/bench -t upload --upload-port /dev/ttyUSB0
+//
+// Results are printed once on the serial port at 115200. Every write drives
+// the pins low, so the relay and buzzer stay off on a wired board. Each case
+// runs with interrupts off on one core, best of several runs, with the loop
+// overhead subtracted.
+
+#if !defined(ARDUINO)
+#error "gpio_bench runs on the ESP32; build it as a sketch (see the header)"
+#endif
+
+#include <Arduino.h>
+
+#include "cycle_counter.h"
+#include "gpio.h"
+
+static const int callsPerRun = 1000;
+static const int runs = 20;
+
+static volatile uint32_t sink;
+
+template <typename Body>
+static uint32_t bestCycles(Body body) {
+  uint32_t best = UINT32_MAX;
+  for (int run = 0; run < runs; run++) {
+    portDISABLE_INTERRUPTS();
+    uint32_t start = cycleCount();
+    for (int i = 0; i < callsPerRun; i++) {
+      body();
+    }
+    uint32_t elapsed = cycleCount() - start;
+    portENABLE_INTERRUPTS();
+    best = elapsed < best ? elapsed : best;
+  }
+  return best;
+}
+
+static uint32_t loopCycles;
+
+template <typename Body>
+static void report(const char* name, Body body) {
+  uint32_t cycles = bestCycles(body);
+  cycles = cycles > loopCycles ? cycles - loopCycles : 0;
+  Serial.printf("%-40s %8.1f cycles %8.1f ns\n", name, (float)cycles / callsPerRun,
+                (float)cycles / callsPerRun * 1000 / cyclesPerMicrosecond());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  // Outputs latched low before they are enabled; buttons as in the firmware
+  digitalWrite(Board::relayPin, LOW);
+  digitalWrite(Board::buzzerPin, LOW);
+  pinMode(Board::relayPin, OUTPUT);
+  pinMode(Board::buzzerPin, OUTPUT);
+  pinMode(Board::menuButtonPin, INPUT_PULLUP);
+  pinMode(Board::plusButtonPin, INPUT_PULLUP);
+  pinMode(Board::minusButtonPin, INPUT_PULLUP);
+
+  loopCycles = bestCycles([]() { sink = 0; });
+  Serial.printf("%u MHz, %d calls per run, loop overhead %u cycles per run\n",
+                (unsigned)cyclesPerMicrosecond(), callsPerRun, (unsigned)loopCycles);
+
+  report("relay write: digitalWrite", []() {
+    digitalWrite(Board::relayPin, LOW);
+    sink = 0;
+  });
+  report("relay write: GPIO.out_w1tc", []() {
+    RelayOutput::write(false);
+    sink = 0;
+  });
+  report("relay+buzzer: digitalWrite x2", []() {
+    digitalWrite(Board::relayPin, LOW);
+    digitalWrite(Board::buzzerPin, LOW);
+    sink = 0;
+  });
+  report("relay+buzzer: register x2", []() {
+    RelayOutput::write(false);
+    BuzzerOutput::write(false);
+    sink = 0;
+  });
+  report("buttons: digitalRead x3", []() {
+    sink = digitalRead(Board::menuButtonPin) + digitalRead(Board::plusButtonPin) +
+           digitalRead(Board::minusButtonPin);
+  });
+  report("buttons: GpioInput::read x3", []() {
+    sink = MenuButtonInput::read() + PlusButtonInput::read() + MinusButtonInput::read();
+  });
+  report("buttons: one GPIO.in1 load", []() {
+    uint32_t word = ButtonInputs::read();
+    sink = ButtonInputs::level<Board::menuButtonPin>(word) +
+           ButtonInputs::level<Board::plusButtonPin>(word) +
+           ButtonInputs::level<Board::minusButtonPin>(word);
+  });
+}
+
+void loop() {
+  delay(1000);
+}
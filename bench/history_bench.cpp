@@ -0,0 +1,118 @@
+// Host benchmark for MoistureHistory compression.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude bench/history_bench.cpp src/moisture_history.cpp -o history_bench
+//
+// Feeds synthetic 1 Hz traces through the encoder, checks the decoded points
+// against the input and reports bits per point, compression ratio against
+// the in-memory MoistureSample and decode throughput.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "moisture_history.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Slow drying with an occasional +-1 % flicker, watered back up when it
+// crosses the threshold
+static MoistureSample stableSoil(uint32_t i, uint32_t& timeMs, int& percent) {
+  static bool relay = false;
+  if (i % 1800 == 0 && percent > 0) percent--;
+  if (percent < 40) relay = true;
+  if (relay && i % 10 == 0) percent++;
+  if (percent >= 55) relay = false;
+
+  MoistureSample s;
+  timeMs += 1000 + (rand() % 50 == 0 ? 1 : 0);   // timer wheel lateness
+  s.timeMs = timeMs;
+  s.raw = 0;
+  s.percent = percent + (rand() % 200 == 0 ? 1 : 0);
+  s.flags = relay ? SAMPLE_RELAY_ON : 0;
+  return s;
+}
+
+// Every sample differs: worst case for the value encoding
+static MoistureSample noisySoil(uint32_t, uint32_t& timeMs, int&) {
+  MoistureSample s;
+  timeMs += 1000;
+  s.timeMs = timeMs;
+  s.raw = 0;
+  s.percent = 30 + rand() % 40;
+  s.flags = 0;
+  return s;
+}
+
+typedef MoistureSample (*Trace)(uint32_t, uint32_t&, int&);
+
+static void run(const char* name, Trace trace, uint32_t count) {
+  static MoistureHistory history;
+  history = MoistureHistory();
+  std::vector<HistoryPoint> expected;
+  expected.reserve(count);
+
+  srand(1);
+  uint32_t timeMs = 0;
+  int percent = 60;
+  Clock::time_point start = Clock::now();
+  for (uint32_t i = 0; i < count; i++) {
+    MoistureSample s = trace(i, timeMs, percent);
+    history.append(s);
+    HistoryPoint p = { s.timeMs / 1000, s.percent, s.flags };
+    expected.push_back(p);
+  }
+  double encodeSeconds = secondsSince(start);
+
+  // Only the retained tail can be checked
+  size_t first = expected.size() - history.points();
+  uint32_t mismatches = 0;
+  uint32_t decoded = 0;
+  const int passes = 10;
+  start = Clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    MoistureHistory::Reader reader = history.read(0);
+    HistoryPoint p;
+    size_t i = first;
+    while (reader.next(p)) {
+      if (pass == 0) {
+        const HistoryPoint& e = expected[i];
+        if (e.time != p.time || e.percent != p.percent || e.flags != p.flags) {
+          mismatches++;
+        }
+      }
+      i++;
+      decoded++;
+    }
+    if (pass == 0 && i != expected.size()) {
+      printf("%s: decoded %u points, expected %u\n", name, (unsigned)(i - first),
+             (unsigned)history.points());
+    }
+  }
+  double decodeSeconds = secondsSince(start);
+
+  double bits = history.centibitsPerPoint() / 100.0;
+  printf("%-8s %u points (%.1f h) in %u blocks, %.2f bits/point, ratio %.0fx vs MoistureSample\n",
+         name, history.points(), (history.newestTime() - history.oldestTime()) / 3600.0,
+         (unsigned)history.blocks(), bits, sizeof(MoistureSample) * 8 / bits);
+  printf("         encode %.1f ns/point, decode %.1f Mpoints/s, %u mismatches\n",
+         encodeSeconds * 1e9 / count, decoded / decodeSeconds / 1e6, mismatches);
+
+  // Random access: a read starting mid-history
+  uint32_t from = (history.oldestTime() + history.newestTime()) / 2;
+  MoistureHistory::Reader reader = history.read(from);
+  HistoryPoint p;
+  if (!reader.next(p) || p.time < from || p.time > from + 2) {
+    printf("         seek to %u failed\n", from);
+  }
+}
+
+int main() {
+  run("stable", stableSoil, 7 * 24 * 3600);
+  run("noisy", noisySoil, 24 * 3600);
+  return 0;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+// Minimal Google Benchmark-style harness for the host benches.
+//
+//   static void BM_thing(BenchState& state) {
+//     while (state.keepRunning()) { doNotOptimize(thing()); }
+//   }
+//   BENCHMARK(BM_thing);
+//   int main(int argc, char** argv) { return runBenchmarks(argc, argv); }
+//
+// Each benchmark doubles its iteration count until a run takes at least
+// --min-time seconds (default 0.2), then reports the median of
+// --repetitions runs (default 3) in ns per iteration.
+//
+//   --json FILE            write results in Google Benchmark's JSON layout
+//   --baseline FILE        compare against a previous --json file
+//   --max-regression PCT   flag benchmarks slower than baseline by more
+//                          than PCT percent (default 10); exit status 1
+//   --filter TEXT          only run benchmarks whose name contains TEXT
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+class BenchState {
+ public:
+  explicit BenchState(uint64_t iterations) : remaining_(iterations) {}
+
+  bool keepRunning() { return remaining_-- > 0; }
+
+ private:
+  uint64_t remaining_;
+};
+
+typedef void (*BenchFunction)(BenchState& state);
+
+// Keeps `value` (and the work producing it) from being optimised away
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  __asm__ __volatile__("" : : "r,m"(value) : "memory");
+}
+
+struct BenchEntry {
+  const char* name;
+  BenchFunction function;
+};
+
+inline std::vector<BenchEntry>& benchRegistry() {
+  static std::vector<BenchEntry> registry;
+  return registry;
+}
+
+struct BenchRegistrar {
+  BenchRegistrar(const char* name, BenchFunction function) {
+    BenchEntry entry = { name, function };
+    benchRegistry().push_back(entry);
+  }
+};
+
+#define BENCH_CONCAT2(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT2(a, b)
+#define BENCHMARK(function) \
+  static BenchRegistrar BENCH_CONCAT(benchRegistrar, __LINE__)(#function, function)
+
+struct BenchResult {
+  const char* name;
+  uint64_t iterations;
+  double nsPerIteration;
+};
+
+inline double benchRun(BenchFunction function, uint64_t iterations) {
+  typedef std::chrono::steady_clock Clock;
+  BenchState state(iterations);
+  Clock::time_point start = Clock::now();
+  function(state);
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+inline BenchResult benchMeasure(const BenchEntry& entry, double minTime, int repetitions) {
+  uint64_t iterations = 1;
+  while (benchRun(entry.function, iterations) < minTime && iterations < (1ull << 40)) {
+    iterations *= 2;
+  }
+
+  std::vector<double> ns;
+  for (int r = 0; r < repetitions; r++) {
+    ns.push_back(benchRun(entry.function, iterations) * 1e9 / iterations);
+  }
+  std::sort(ns.begin(), ns.end());
+  BenchResult result = { entry.name, iterations, ns[ns.size() / 2] };
+  return result;
+}
+
+inline bool benchWriteJson(const char* path, const std::vector<BenchResult>& results) {
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  char date[32];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  fprintf(f, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"library_build_type\": \"release\"\n"
+             "  },\n  \"benchmarks\": [\n", date);
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchResult& r = results[i];
+    fprintf(f, "    {\n      \"name\": \"%s\",\n      \"run_type\": \"iteration\",\n"
+               "      \"iterations\": %llu,\n      \"real_time\": %.3f,\n"
+               "      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\"\n    }%s\n",
+            r.name, (unsigned long long)r.iterations, r.nsPerIteration, r.nsPerIteration,
+            i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+  return true;
+}
+
+// Finds `"real_time": x` in the object that names `name`; only has to read
+// files written by benchWriteJson() or Google Benchmark itself
+inline bool benchBaselineTime(const char* json, const char* name, double& ns) {
+  char key[160];
+  snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+  const char* at = strstr(json, key);
+  if (!at) {
+    return false;
+  }
+  const char* end = strchr(at, '}');
+  const char* time = strstr(at, "\"real_time\":");
+  if (!time || (end && time > end)) {
+    return false;
+  }
+  ns = strtod(time + strlen("\"real_time\":"), nullptr);
+  return true;
+}
+
+inline char* benchReadFile(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    return nullptr;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char* data = static_cast<char*>(malloc(size + 1));
+  size_t n = fread(data, 1, size, f);
+  data[n] = '\0';
+  fclose(f);
+  return data;
+}
+
+inline int runBenchmarks(int argc, char** argv) {
+  const char* jsonPath = nullptr;
+  const char* baselinePath = nullptr;
+  const char* filter = nullptr;
+  double maxRegression = 10;
+  double minTime = 0.2;
+  int repetitions = 3;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--json") == 0 && hasValue) {
+      jsonPath = argv[++i];
+    } else if (strcmp(argv[i], "--baseline") == 0 && hasValue) {
+      baselinePath = argv[++i];
+    } else if (strcmp(argv[i], "--max-regression") == 0 && hasValue) {
+      maxRegression = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--min-time") == 0 && hasValue) {
+      minTime = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+      repetitions = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+      filter = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--json FILE] [--baseline FILE] [--max-regression PCT]\n"
+                      "          [--min-time SECONDS] [--repetitions N] [--filter TEXT]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  char* baseline = nullptr;
+  if (baselinePath && !(baseline = benchReadFile(baselinePath))) {
+    fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+    return 2;
+  }
+
+  printf("%-36s %14s %12s %12s\n", "benchmark", "iterations", "ns/iter", "vs baseline");
+  std::vector<BenchResult> results;
+  int regressions = 0;
+  for (size_t i = 0; i < benchRegistry().size(); i++) {
+    const BenchEntry& entry = benchRegistry()[i];
+    if (filter && !strstr(entry.name, filter)) {
+      continue;
+    }
+    BenchResult r = benchMeasure(entry, minTime, repetitions);
+    results.push_back(r);
+
+    double base;
+    if (baseline && benchBaselineTime(baseline, r.name, base) && base > 0) {
+      double change = (r.nsPerIteration / base - 1) * 100;
+      bool regressed = change > maxRegression;
+      regressions += regressed;
+      printf("%-36s %14llu %12.2f %+11.1f%%%s\n", r.name, (unsigned long long)r.iterations,
+             r.nsPerIteration, change, regressed ? "  REGRESSION" : "");
+    } else {
+      printf("%-36s %14llu %12.2f %12s\n", r.name, (unsigned long long)r.iterations,
+             r.nsPerIteration, baseline ? "new" : "");
+    }
+  }
+  free(baseline);
+
+  if (jsonPath && !benchWriteJson(jsonPath, results)) {
+    fprintf(stderr, "cannot write %s\n", jsonPath);
+    return 2;
+  }
+  if (regressions) {
+    printf("%d benchmark(s) slower than baseline by more than %.0f%%\n", regressions,
+           maxRegression);
+    return 1;
+  }
+  return 0;
+}
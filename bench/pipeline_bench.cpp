@@ -0,0 +1,101 @@
+// Host benchmark suite for the per-sample path, on the native HAL.
+//
+//   SOURCES=$(ls src/*.cpp | grep -v main_native)
+//   g++ -O2 -std=gnu++11 -pthread -Iinclude bench/pipeline_bench.cpp $SOURCES -o pipeline_bench
+//   ./pipeline_bench --baseline bench/baseline/pipeline_bench.json
+//
+// Covers raw-to-percent conversion (the original 100 - map() next to
+// calibratedPercent()), the probe's burst average, the relay decision,
+// /status JSON rendering, LCD frame composition and one whole control
+// sample tick. Exits 1 when any of them is more than --max-regression
+// percent (default 10) slower than the baseline; refresh the baseline with
+// --json bench/baseline/pipeline_bench.json on the reference host.
+
+#include "microbench.h"
+
+#include "controller.h"
+#include "hal_native.h"
+#include "moisture_probe.h"
+#include "pins.h"
+
+static const int adcBurstSize = 8;
+
+// Arduino's map(), as the firmware used it before ProbeCalibration
+static long arduinoMap(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+static void BM_RawToPercentMap(BenchState& state) {
+  uint32_t raw = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(100 - arduinoMap(raw, 0, 4095, 0, 100));
+    raw = (raw + 37) & 4095;
+  }
+}
+BENCHMARK(BM_RawToPercentMap);
+
+static void BM_RawToPercentCalibrated(BenchState& state) {
+  uint32_t raw = 0;
+  while (state.keepRunning()) {
+    doNotOptimize(calibratedPercent(raw, AnalogProbe::defaultCalibration));
+    raw = (raw + 37) & 4095;
+  }
+}
+BENCHMARK(BM_RawToPercentCalibrated);
+
+static void BM_ProbeBurstAverage(BenchState& state) {
+  AnalogProbe probe(Board::moisturePin, adcBurstSize);
+  probe.begin();
+  uint16_t raw = 0;
+  while (state.keepRunning()) {
+    nativeSetAnalog(Board::moisturePin, raw);
+    doNotOptimize(probe.read());
+    raw = (raw + 37) & 4095;
+  }
+}
+BENCHMARK(BM_ProbeBurstAverage);
+
+// Sweeps the percentage, so the relay switches twice per 100 decisions
+static void BM_ThresholdDecision(BenchState& state) {
+  int percent = 0;
+  while (state.keepRunning()) {
+    processIrrigation(percent);
+    percent = percent == 99 ? 0 : percent + 1;
+  }
+}
+BENCHMARK(BM_ThresholdDecision);
+
+static void BM_StatusJson(BenchState& state) {
+  static char storage[4096];
+  while (state.keepRunning()) {
+    TextBuffer json(storage, sizeof(storage));
+    statusJson(json);
+    doNotOptimize(json.length());
+  }
+}
+BENCHMARK(BM_StatusJson);
+
+static void BM_LcdFrame(BenchState& state) {
+  while (state.keepRunning()) {
+    updateDisplay();
+  }
+}
+BENCHMARK(BM_LcdFrame);
+
+static void BM_SampleTick(BenchState& state) {
+  uint16_t raw = 0;
+  while (state.keepRunning()) {
+    nativeSetAnalog(Board::moisturePin, raw);
+    sampleMoisture(nullptr);
+    raw = (raw + 37) & 4095;
+  }
+}
+BENCHMARK(BM_SampleTick);
+
+int main(int argc, char** argv) {
+  nativeSetQuiet(true);
+  nativeUseMemoryStorage();
+  nativeSetAnalog(Board::moisturePin, 2048);
+  controllerBegin();
+  return runBenchmarks(argc, argv);
+}
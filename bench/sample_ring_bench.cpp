@@ -0,0 +1,124 @@
+// Host throughput benchmark for SampleRing.
+//
+//   g++ -O2 -std=gnu++11 -pthread -Iinclude bench/sample_ring_bench.cpp -o sample_ring_bench
+//
+// Reports single-threaded push+pop cost and cross-thread throughput with one
+// producer and every reader draining on its own thread. The producer is paced
+// by the slowest reader so nobody is lapped: every reader should pop every
+// sample with zero overruns, and anything else is a bug.
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "moisture_sample.h"
+
+static const uint32_t iterations = 20000000;
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void benchSingleThread() {
+  static MoistureSampleRing ring;
+  MoistureSample s = {};
+  uint32_t checksum = 0;
+
+  Clock::time_point start = Clock::now();
+  for (uint32_t i = 0; i < iterations; i++) {
+    s.timeMs = i;
+    ring.push(s);
+    ring.pop(READER_CONTROL, s);
+    checksum += s.timeMs;
+  }
+  double elapsed = secondsSince(start);
+
+  printf("single thread: %.1f ns per push+pop (checksum %u)\n",
+         elapsed * 1e9 / iterations, checksum);
+}
+
+// Pops so far, one cache line per reader so the producer's polling doesn't
+// slow the readers down
+struct alignas(CACHE_LINE_SIZE) ReaderProgress {
+  std::atomic<uint32_t> popped;
+};
+
+static void benchThreaded() {
+  static MoistureSampleRing ring;
+  static ReaderProgress progress[SAMPLE_READER_COUNT];
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+
+  for (int r = 0; r < SAMPLE_READER_COUNT; r++) {
+    progress[r].popped.store(0, std::memory_order_relaxed);
+    readers.emplace_back([&, r]() {
+      MoistureSample s;
+      uint32_t last = 0;
+      uint32_t count = 0;
+      for (;;) {
+        // Sample the flag before popping so the final drain isn't skipped
+        bool finished = done.load(std::memory_order_acquire);
+        if (ring.pop(r, s)) {
+          if (count > 0 && s.timeMs <= last) {
+            printf("reader %d: out of order %u after %u\n", r, s.timeMs, last);
+          }
+          last = s.timeMs;
+          count++;
+          progress[r].popped.store(count, std::memory_order_release);
+        } else if (finished) {
+          break;
+        } else {
+          std::this_thread::yield();   // for hosts with fewer cores than threads
+        }
+      }
+    });
+  }
+
+  // Never get more than capacity - 1 ahead of the slowest reader
+  const uint32_t window = MoistureSampleRing::capacity() - 1;
+  uint32_t slowest = 0;
+  uint64_t stalls = 0;
+
+  MoistureSample s = {};
+  Clock::time_point start = Clock::now();
+  for (uint32_t i = 1; i <= iterations; i++) {
+    while (i - 1 - slowest >= window) {
+      uint32_t least = UINT32_MAX;
+      for (int r = 0; r < SAMPLE_READER_COUNT; r++) {
+        uint32_t popped = progress[r].popped.load(std::memory_order_acquire);
+        least = popped < least ? popped : least;
+      }
+      slowest = least;
+      if (i - 1 - slowest >= window) {
+        stalls++;
+        std::this_thread::yield();
+      }
+    }
+    s.timeMs = i;
+    ring.push(s);
+  }
+  done.store(true, std::memory_order_release);
+  for (size_t i = 0; i < readers.size(); i++) {
+    readers[i].join();
+  }
+  double elapsed = secondsSince(start);
+
+  printf("threaded, paced to the slowest reader: %.1f M samples/s to each of %d readers "
+         "(%llu producer stalls)\n",
+         iterations / elapsed / 1e6, SAMPLE_READER_COUNT, (unsigned long long)stalls);
+  for (int r = 0; r < SAMPLE_READER_COUNT; r++) {
+    uint32_t popped = progress[r].popped.load(std::memory_order_relaxed);
+    printf("  reader %d: popped %u of %u, overruns %u%s\n", r, popped, iterations,
+           ring.overruns(r), popped == iterations && ring.overruns(r) == 0 ? "" : "  MISSED");
+  }
+}
+
+int main() {
+  benchSingleThread();
+  benchThreaded();
+  return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "text_buffer.h"
+
+// When the WiFi access point should be up.
+//
+// The AP comes up at boot and on request (the minus button outside the
+// menu). It goes down once nothing has used it for a while: emptyTimeoutMs
+// after the last station left (or the AP started with none joining), or
+// idleTimeoutMs without an HTTP request while a station is still
+// associated, since phones stay joined to a network long after the page is
+// closed. The network task polls it and switches the radio; the totals
+// report how long the radio has been on.
+enum ApAction {
+  AP_NONE,
+  AP_START,
+  AP_STOP
+};
+
+class ApLifecycle {
+ public:
+  static const uint32_t emptyTimeoutMs = 120000;
+  static const uint32_t idleTimeoutMs = 600000;
+
+  ApLifecycle();
+
+  // Any task
+  void request() { requested_ = true; }
+  bool on() const { return on_; }
+
+  // Network task. `lastRequestMs` is the halMillis() of the last HTTP
+  // request served.
+  ApAction poll(uint32_t nowMs, int stations, uint32_t lastRequestMs);
+  void started(uint32_t nowMs);
+  void stopped(uint32_t nowMs);
+
+  uint64_t radioOnMs(uint32_t nowMs) const;
+  void json(TextBuffer& out, uint32_t nowMs) const;
+
+ private:
+  volatile bool requested_;
+  volatile bool on_;
+  uint32_t onSinceMs_;
+  uint32_t lastActivityMs_;
+  uint32_t lastRequestMs_;
+  int stations_;
+  uint32_t starts_;
+  uint64_t radioOnMs_;     // completed on periods
+};
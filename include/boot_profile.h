@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "text_buffer.h"
+
+// Boot-phase timestamps.
+//
+// Each init step calls bootMark() when it finishes; the first mark of a
+// phase wins, so any task may mark. Times are halMicros(), i.e. since the
+// app (not the ROM bootloader) started. Marking is a single atomic store,
+// cheap enough for the control task; once every phase has been reached the
+// network task prints the boot log, including the time to the first control
+// decision.
+//
+// With -DFAST_BOOT (see [env:esp32dev-fastboot]) setup() only brings up the
+// relay safety state and the control task; the LCD comes up on the UI task
+// and WiFi/HTTP on the network task, in parallel with sampling.
+enum BootPhase : uint8_t {
+  BOOT_SETUP = 0,         // setup() entered, serial up
+  BOOT_SAFE_OUTPUTS,      // relay and buzzer driven off
+  BOOT_STORAGE,           // threshold and water totals loaded
+  BOOT_DRIVERS,           // probe and flow meter
+  BOOT_CONTROL_STARTED,   // control task running
+  BOOT_FIRST_SAMPLE,      // first sample published, relay state known
+  BOOT_FIRST_DECISION,    // first threshold decision after sensor warm-up
+  BOOT_DISPLAY,           // LCD initialised
+  BOOT_NETWORK,           // access point up
+  BOOT_HTTP,              // HTTP server listening
+  BOOT_PHASE_COUNT
+};
+
+void bootMark(BootPhase phase);
+
+// Network task: prints the boot log once, after the last phase is marked
+void bootReportPoll();
+
+// Microseconds at which `phase` was reached; false until then
+bool bootPhaseTime(BootPhase phase, uint32_t& us);
+
+bool bootFastPath();
+
+// {"fastBoot":..,"complete":..,"phases":{"setup":us,...}}
+void bootProfileJson(TextBuffer& out);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ap_lifecycle.h"
+#include "controller_state.h"
+#include "coroutine.h"
+#include "fixed_point.h"
+#include "text_buffer.h"
+
+// Irrigation controller logic, shared by the ESP32 firmware (src/main.cpp)
+// and the Linux build (src/main_native.cpp). It reaches the hardware only
+// through hal.h; the entry points decide how the task bodies are scheduled.
+
+extern ControllerState controller;
+extern CoScheduler uiCoroutines;
+extern ApLifecycle accessPoint;
+
+// Pins, persisted settings, drivers, LCD and UI coroutines. The control
+// half drives the relay off first and is all the control task needs; the
+// fast boot path leaves the display half to the UI task.
+//
+// A field-mode web window resumes instead: the relay keeps the level the
+// wake cycle drove and the threshold comes from RTC memory, not NVS.
+struct ControllerResume {
+  bool relayOn;
+  int threshold;
+};
+void controllerBegin(const ControllerResume* resume = nullptr);
+void controllerBeginControl(const ControllerResume* resume = nullptr);
+void controllerBeginDisplay();
+
+// Registers the routes and starts the HTTP server on port 80
+void setupServer();
+
+// Network task body: appends new samples to the history, then serves
+// pending HTTP requests
+void networkPoll();
+
+// halMillis() when the last HTTP request was served, network task
+uint32_t httpLastRequestMs();
+
+// Control task: runs due timers, then applies queued commands. Returns ms
+// until the next control deadline; sleep on controller.waitForCommand().
+void controlBegin();
+uint32_t controlPoll();
+
+// UI task: runs due timers and runnable coroutines. Returns ms until the
+// next UI deadline; coroutine events should cut the sleep short.
+void uiBegin();
+uint32_t uiPoll();
+
+// Per-sample path, also driven directly by bench/pipeline_bench.cpp.
+// sampleMoisture() is the control timer callback: probe read, publish,
+// water accounting and the relay decision. moistureLevel() keeps the
+// fraction of a percent for filters; moisturePercent() is the whole percent.
+Fixed16 moistureLevel(uint32_t reading);
+int moisturePercent(uint32_t reading);
+void processIrrigation(int moisturePercentage);
+void sampleMoisture(void* arg);
+void updateDisplay();
+void statusJson(TextBuffer& json);
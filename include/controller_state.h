@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#if defined(ESP32)
+#include <Arduino.h>
+#include <freertos/queue.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#include "seqlock.h"
+
+// Requests from the web handlers and the menu. Only the control task applies
+// them, so every controller field has exactly one writer.
+enum ControllerCommandType : uint8_t {
+  CMD_SET_THRESHOLD,
+  CMD_ADJUST_THRESHOLD,
+  CMD_TOGGLE_MODE,
+  CMD_SET_MODE,          // value: 1 WiFi, 0 manual
+  CMD_SET_MENU_ACTIVE,
+  CMD_SET_SENSOR_READY,
+  CMD_STATUS_POLLED,     // a web client fetched /status
+};
+
+struct ControllerCommand {
+  ControllerCommandType type;
+  int16_t value;
+};
+
+// Consistent view of one control decision
+struct ControllerSnapshot {
+  uint32_t timeMs;
+  uint32_t raw;
+  uint8_t percent;
+  uint8_t threshold;
+  bool wifiMode;
+  bool relayOn;
+  bool buzzerOn;
+  bool menuActive;
+  bool sensorReady;
+};
+
+class ControllerState {
+ public:
+  static const int queueLength = 8;
+
+  ControllerState();
+
+  void begin(int threshold, bool wifiMode);
+
+  // Any task. Never blocks; returns false if the queue is full.
+  bool post(ControllerCommandType type, int16_t value = 0);
+
+  // Control task only. Applies the oldest queued command without waiting;
+  // returns true if there was one.
+  bool applyNext();
+
+  // Control task only. Sleeps until a command is queued or `timeoutMs`
+  // passes, without consuming it; returns true if one is queued.
+  bool waitForCommand(uint32_t timeoutMs);
+
+  // Control task only. Publishes a decision for snapshot() readers.
+  void publish(const ControllerSnapshot& snapshot);
+
+  // Any task, lock-free
+  ControllerSnapshot snapshot() const { return snapshot_.read(); }
+  int threshold() const { return threshold_.load(std::memory_order_relaxed); }
+  bool wifiMode() const { return wifiMode_.load(std::memory_order_relaxed); }
+  bool menuActive() const { return menuActive_.load(std::memory_order_relaxed); }
+  bool sensorReady() const { return sensorReady_.load(std::memory_order_relaxed); }
+  uint32_t droppedCommands() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // Control task only. True once per CMD_STATUS_POLLED since the last call;
+  // in WiFi mode the relay only moves when the dashboard asks for status.
+  bool takeStatusPoll();
+
+ private:
+  void apply(const ControllerCommand& cmd);
+
+  std::atomic<int> threshold_;
+  std::atomic<bool> wifiMode_;
+  std::atomic<bool> menuActive_;
+  std::atomic<bool> sensorReady_;
+  std::atomic<uint32_t> dropped_;
+  bool statusPolled_;
+
+  Seqlock<ControllerSnapshot> snapshot_;
+
+#if defined(ESP32)
+  QueueHandle_t commands_;
+  StaticQueue_t queueBuffer_;
+  uint8_t queueStorage_[queueLength * sizeof(ControllerCommand)];
+#else
+  // Linux builds: the same bounded queue under a mutex
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  ControllerCommand queue_[queueLength];
+  int queueHead_;
+  int queueCount_;
+#endif
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "timer_wheel.h"
+
+// Stackless coroutines for sequential device logic (splash screens, message
+// timeouts, warm-up sequences) without blocking the task that runs them.
+//
+// A coroutine is a CoFrame subclass whose resume() body is wrapped in
+// CO_BEGIN()/CO_END(). State that must survive an await lives in members,
+// not locals, and each await macro must be on its own line (the resume point
+// is the line number). Frames are placement-constructed in a fixed pool
+// owned by the scheduler; nothing is allocated at runtime.
+//
+// The espressif32 Arduino toolchain (GCC 8) has no C++20 coroutines, hence
+// the switch-based resume points.
+
+enum CoStatus : uint8_t {
+  CO_WAITING,
+  CO_DONE,
+};
+
+class CoScheduler;
+
+class CoFrame {
+ public:
+  CoFrame();
+  virtual ~CoFrame() {}
+  virtual CoStatus resume() = 0;
+
+ protected:
+  // True when the last CO_AWAIT_EVENT_FOR() woke on its timeout
+  bool timedOut() const { return wokenBy_ == 0; }
+  // Events that ended the last event await
+  uint32_t wokenBy() const { return wokenBy_; }
+
+  void sleepFor(uint32_t ms);
+  void waitFor(uint32_t events, uint32_t timeoutMs = 0);
+  void yieldNow() { runnable_ = true; }
+
+  uint16_t line_;
+
+ private:
+  friend class CoScheduler;
+  static void onTimer(void* arg);
+
+  CoScheduler* scheduler_;
+  WheelTimer timer_;
+  uint32_t waitEvents_;
+  uint32_t wokenBy_;
+  bool runnable_;
+};
+
+// For -Wimplicit-fallthrough: a /* fallthrough */ comment is gone by the
+// time a macro expands, so the resume label in CO_AWAIT_UNTIL needs this
+#if defined(__has_attribute)
+#if __has_attribute(fallthrough)
+#define CO_FALLTHROUGH __attribute__((fallthrough))
+#endif
+#endif
+#ifndef CO_FALLTHROUGH
+#define CO_FALLTHROUGH do { } while (0)
+#endif
+
+#define CO_BEGIN() switch (line_) { case 0:
+
+#define CO_END() } line_ = 0; return CO_DONE
+
+// Resume on the next scheduler pass
+#define CO_YIELD() \
+  do { yieldNow(); line_ = __LINE__; return CO_WAITING; case __LINE__:; } while (0)
+
+#define CO_SLEEP(ms) \
+  do { sleepFor(ms); line_ = __LINE__; return CO_WAITING; case __LINE__:; } while (0)
+
+// Wait for any of the event bits (see CoScheduler::signal)
+#define CO_AWAIT_EVENT(events) \
+  do { waitFor(events); line_ = __LINE__; return CO_WAITING; case __LINE__:; } while (0)
+
+// Same with a timeout; check timedOut() afterwards
+#define CO_AWAIT_EVENT_FOR(events, ms) \
+  do { waitFor(events, ms); line_ = __LINE__; return CO_WAITING; case __LINE__:; } while (0)
+
+// Re-evaluated on every wake of the given events until true
+#define CO_AWAIT_UNTIL(cond, events) \
+  do { line_ = __LINE__; CO_FALLTHROUGH; case __LINE__: \
+    if (!(cond)) { waitFor(events); return CO_WAITING; } } while (0)
+
+class CoScheduler {
+ public:
+  static const int frameSlots = 8;
+  static const size_t frameSize = 128;
+
+  typedef void (*WakeHook)(void* arg);
+
+  explicit CoScheduler(TimerWheel& wheel);
+
+  // Called from signal() so the owning task stops sleeping early
+  void setWakeHook(WakeHook hook, void* arg);
+
+  // Start a coroutine; returns nullptr if the pool is exhausted
+  template <typename T, typename... Args>
+  T* spawn(Args&&... args) {
+    static_assert(sizeof(T) <= frameSize, "coroutine frame exceeds pool slot");
+    static_assert(alignof(T) <= alignof(max_align_t), "coroutine frame over-aligned");
+    int slot = freeSlot();
+    if (slot < 0) {
+      spawnFailures_++;
+      return nullptr;
+    }
+    T* frame = new (pool_[slot]) T(std::forward<Args>(args)...);
+    attach(slot, frame);
+    return frame;
+  }
+
+  // Set event bits. Safe from any task or ISR.
+  void signal(uint32_t events);
+
+  // Resume every runnable frame; call after advancing the wheel
+  void run();
+
+  uint32_t resumes() const { return resumes_; }
+  uint32_t spawnFailures() const { return spawnFailures_; }
+  int active() const;
+
+ private:
+  friend class CoFrame;
+
+  int freeSlot() const;
+  void attach(int slot, CoFrame* frame);
+
+  TimerWheel& wheel_;
+  WakeHook wakeHook_;
+  void* wakeArg_;
+  std::atomic<uint32_t> pending_;
+  CoFrame* frames_[frameSlots];
+  alignas(max_align_t) uint8_t pool_[frameSlots][frameSize];
+  uint32_t resumes_;
+  uint32_t spawnFailures_;
+};
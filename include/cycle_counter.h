@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// CPU cycle counter for cheap interval timing. On the ESP32 this is the
+// per-core CCOUNT register (one instruction), wrapping every ~17.9 s at
+// 240 MHz, so intervals must be measured on one core and stay shorter than
+// that. Hosts fall back to a nanosecond clock.
+#if defined(__XTENSA__)
+
+#include <Arduino.h>
+
+inline uint32_t cycleCount() {
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+  return ccount;
+}
+
+inline uint32_t cyclesPerMicrosecond() {
+  return getCpuFrequencyMhz();
+}
+
+#else
+
+#include <chrono>
+
+inline uint32_t cycleCount() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t cyclesPerMicrosecond() {
+  return 1000;
+}
+
+#endif
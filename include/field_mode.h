@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "fixed_point.h"
+#include "hal.h"
+#include "text_buffer.h"
+
+// Duty-cycled field mode for solar-powered beds (-DFIELD_MODE, see
+// [env:esp32dev-field]).
+//
+// Every wake from deep sleep runs one fieldCycle(): a probe burst folded
+// into an EMA, the threshold decision and one history entry, then straight
+// back to sleep with the relay level held by the RTC domain. State between
+// cycles lives in RTC slow memory, so NVS is only read on a cold boot.
+// Watering cycles come back sooner so the relay isn't held on for a whole
+// interval.
+//
+// A press on the menu button, or every FIELD_WEB_EVERY cycles, the cycle
+// asks for a web window instead: the normal firmware (tasks, AP, HTTP)
+// runs for FIELD_WEB_WINDOW_S and then calls fieldSleep() itself.
+//
+// Awake time is measured from app start to the deep-sleep call (the ROM
+// bootloader before it isn't visible to the app) and logged with the next
+// cycle.
+#ifndef FIELD_SAMPLE_INTERVAL_S
+#define FIELD_SAMPLE_INTERVAL_S 600
+#endif
+#ifndef FIELD_WATERING_INTERVAL_S
+#define FIELD_WATERING_INTERVAL_S 30
+#endif
+#ifndef FIELD_WEB_EVERY
+#define FIELD_WEB_EVERY 144
+#endif
+#ifndef FIELD_WEB_WINDOW_S
+#define FIELD_WEB_WINDOW_S 300
+#endif
+
+static const int fieldHistorySize = 192;
+static const uint8_t fieldHistoryRelay = 0x80;   // | percent
+
+struct FieldState {
+  uint32_t magic;
+  uint32_t cycles;
+  int32_t threshold;
+  Fixed16 moisture;          // EMA of calibrated percent
+  bool relayOn;
+  uint32_t relayOnSeconds;
+  uint64_t wakeRtcUs;        // halRtcMicros() at the start of this cycle
+  uint32_t lastAwakeUs;      // previous complete cycle
+  uint32_t maxAwakeUs;
+  uint64_t totalAwakeUs;
+  uint32_t historyHead;      // entries written, one per cycle
+  uint8_t history[fieldHistorySize];
+};
+
+enum FieldAction {
+  FIELD_SLEEP,
+  FIELD_WEB_WINDOW
+};
+
+FieldAction fieldCycle(HalWakeCause wake);
+
+// Ends the cycle (or web window) and doesn't return
+void fieldSleep(bool relayOn, int threshold) __attribute__((noreturn));
+bool fieldWebWindowOver();
+
+const FieldState& fieldState();
+void fieldJson(TextBuffer& out);
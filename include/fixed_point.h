@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+
+// Q16.16 fixed point: a signed 16-bit integer part (up to +-32767) and a
+// 16-bit fraction (steps of 1/65536). Arithmetic saturates at the ends of
+// the range instead of wrapping and never touches the FPU, so it can run in
+// ISRs and esp_timer callbacks. Conversions are constexpr, so constants cost
+// nothing at run time:
+//
+//   static constexpr Fixed16 smoothing = Fixed16::fromFloat(0.2f);
+//
+// Quantities with a wider range are scaled into it first (Hz as kHz).
+class Fixed16 {
+ public:
+  static const int fractionBits = 16;
+  static const int32_t rawOne = 1 << fractionBits;
+
+  Fixed16() = default;
+
+  static constexpr Fixed16 fromRaw(int32_t raw) { return Fixed16(raw, RawTag()); }
+  static constexpr Fixed16 fromInt(int32_t value) {
+    return fromRaw(saturate((int64_t)value * rawOne));
+  }
+  // Rounded to the nearest step
+  static constexpr Fixed16 fromFloat(float value) {
+    return fromRaw(saturate((int64_t)(value * rawOne + (value < 0 ? -0.5f : 0.5f))));
+  }
+  // numerator / denominator, truncated toward zero; saturated when the
+  // denominator is 0
+  static constexpr Fixed16 ratio(int64_t numerator, int64_t denominator) {
+    return fromRaw(denominator ? saturate(numerator * rawOne / denominator)
+                               : numerator < 0 ? INT32_MIN : INT32_MAX);
+  }
+  static constexpr Fixed16 max() { return fromRaw(INT32_MAX); }
+  static constexpr Fixed16 min() { return fromRaw(INT32_MIN); }
+
+  constexpr int32_t raw() const { return raw_; }
+  constexpr int32_t floor() const { return raw_ >> fractionBits; }
+  constexpr int32_t ceil() const {
+    return (int32_t)(((int64_t)raw_ + rawOne - 1) >> fractionBits);
+  }
+  constexpr int32_t round() const {
+    return (int32_t)(((int64_t)raw_ + rawOne / 2) >> fractionBits);
+  }
+  constexpr float toFloat() const { return (float)raw_ / rawOne; }
+
+  // Nearest integer to value * factor, for leaving the scaled range (kHz
+  // back to Hz) without saturating at 32767
+  constexpr int32_t roundTimes(int32_t factor) const {
+    return saturate(((int64_t)raw_ * factor + rawOne / 2) >> fractionBits);
+  }
+
+  constexpr Fixed16 operator+(Fixed16 other) const {
+    return fromRaw(saturate((int64_t)raw_ + other.raw_));
+  }
+  constexpr Fixed16 operator-(Fixed16 other) const {
+    return fromRaw(saturate((int64_t)raw_ - other.raw_));
+  }
+  constexpr Fixed16 operator-() const { return fromRaw(saturate(-(int64_t)raw_)); }
+  // Rounded to the nearest step
+  constexpr Fixed16 operator*(Fixed16 other) const {
+    return fromRaw(saturate(((int64_t)raw_ * other.raw_ + rawOne / 2) >> fractionBits));
+  }
+  constexpr Fixed16 operator/(Fixed16 other) const { return ratio(raw_, other.raw_); }
+  constexpr Fixed16 operator*(int32_t factor) const {
+    return fromRaw(saturate((int64_t)raw_ * factor));
+  }
+
+  Fixed16& operator+=(Fixed16 other) { return *this = *this + other; }
+  Fixed16& operator-=(Fixed16 other) { return *this = *this - other; }
+  Fixed16& operator*=(Fixed16 other) { return *this = *this * other; }
+  Fixed16& operator/=(Fixed16 other) { return *this = *this / other; }
+
+  constexpr bool operator==(Fixed16 other) const { return raw_ == other.raw_; }
+  constexpr bool operator!=(Fixed16 other) const { return raw_ != other.raw_; }
+  constexpr bool operator<(Fixed16 other) const { return raw_ < other.raw_; }
+  constexpr bool operator<=(Fixed16 other) const { return raw_ <= other.raw_; }
+  constexpr bool operator>(Fixed16 other) const { return raw_ > other.raw_; }
+  constexpr bool operator>=(Fixed16 other) const { return raw_ >= other.raw_; }
+
+  constexpr Fixed16 clamp(Fixed16 low, Fixed16 high) const {
+    return *this < low ? low : *this > high ? high : *this;
+  }
+
+ private:
+  struct RawTag {};
+  constexpr Fixed16(int32_t raw, RawTag) : raw_(raw) {}
+
+  static constexpr int32_t saturate(int64_t value) {
+    return value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : (int32_t)value;
+  }
+
+  int32_t raw_;
+};
+
+static_assert(Fixed16::fromInt(3).raw() == 3 * 65536, "Q16.16 layout");
+static_assert(Fixed16::fromFloat(0.5f).raw() == 32768, "constexpr conversion");
+static_assert(Fixed16::fromFloat(-1.25f).floor() == -2, "floor rounds down");
+static_assert(Fixed16::fromFloat(1.25f).ceil() == 2 && Fixed16::fromInt(2).ceil() == 2,
+              "ceil rounds up");
+static_assert((Fixed16::fromInt(30000) + Fixed16::fromInt(30000)) == Fixed16::max(),
+              "addition saturates");
+static_assert((Fixed16::fromInt(-200) * Fixed16::fromInt(200)) == Fixed16::min(),
+              "multiplication saturates");
+static_assert(Fixed16::ratio(1, 3).roundTimes(300) == 100, "ratio");
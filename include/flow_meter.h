@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// YF-S201 style meters give ~450 pulses per liter; calibrate per meter
+#ifndef FLOW_PULSES_PER_LITER
+#define FLOW_PULSES_PER_LITER 450
+#endif
+
+// Hall-effect flow meter counted by a PCNT unit. Pulses are counted in
+// hardware; poll() reads the counter and returns the pulses since the
+// previous poll, with no interrupts involved. The 16-bit counter wraps at
+// its high limit, so poll() must run at least once per 32767 pulses (over a
+// minute at any residential flow rate). Linux builds take the pulses fed in
+// through nativeAddPulses() instead.
+class FlowMeter {
+ public:
+  FlowMeter(int pin, int pcntUnit);
+
+  bool begin();
+  uint32_t poll();
+
+ private:
+  static const int16_t counterLimit = INT16_MAX;
+
+  int pin_;
+  int unit_;
+  int16_t last_;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "hal.h"
+#include "pins.h"
+
+#if defined(ESP32)
+#include <soc/gpio_struct.h>
+#endif
+
+// Pins fixed at compile time. On the ESP32 a write is one store to the
+// GPIO set/clear register and a read one load of the input register, with
+// the bank and bit resolved by the compiler, instead of digitalWrite()'s
+// run-time pin lookup. Elsewhere they go through the HAL so the native
+// test hooks still see them. Configure with begin() (pinMode) first.
+template <uint8_t Pin>
+class GpioOutput {
+  static_assert(gpioCanOutput(Pin), "not an output-capable GPIO (0-33, not flash)");
+
+ public:
+  static const uint8_t pin = Pin;
+
+  // Level latched before the pin becomes an output, so it never glitches
+  static void begin(bool level) {
+    write(level);
+    halPinMode(Pin, HAL_OUTPUT);
+  }
+
+  static void write(bool high) {
+#if defined(ESP32)
+    if (Pin < 32) {
+      if (high) {
+        GPIO.out_w1ts = 1u << (Pin & 31);
+      } else {
+        GPIO.out_w1tc = 1u << (Pin & 31);
+      }
+    } else {
+      if (high) {
+        GPIO.out1_w1ts.val = 1u << (Pin & 31);
+      } else {
+        GPIO.out1_w1tc.val = 1u << (Pin & 31);
+      }
+    }
+#else
+    halDigitalWrite(Pin, high);
+#endif
+  }
+
+  // The level being driven
+  static bool read() {
+#if defined(ESP32)
+    return ((Pin < 32 ? GPIO.out : GPIO.out1.val) >> (Pin & 31)) & 1;
+#else
+    return halDigitalRead(Pin);
+#endif
+  }
+};
+
+template <uint8_t Pin>
+class GpioInput {
+  static_assert(gpioCanInput(Pin), "not an input-capable GPIO");
+
+ public:
+  static const uint8_t pin = Pin;
+
+  static void begin(bool pullup) { halPinMode(Pin, pullup ? HAL_INPUT_PULLUP : HAL_INPUT); }
+
+  static bool read() {
+#if defined(ESP32)
+    return ((Pin < 32 ? GPIO.in : GPIO.in1.val) >> (Pin & 31)) & 1;
+#else
+    return halDigitalRead(Pin);
+#endif
+  }
+};
+
+constexpr bool gpioSameBank(int) { return true; }
+template <typename... Pins>
+constexpr bool gpioSameBank(int first, int second, Pins... rest) {
+  return first / 32 == second / 32 && gpioSameBank(second, rest...);
+}
+constexpr bool gpioAllInputs() { return true; }
+template <typename... Pins>
+constexpr bool gpioAllInputs(int first, Pins... rest) {
+  return gpioCanInput(first) && gpioAllInputs(rest...);
+}
+
+// Inputs in one 32-pin bank sampled together: read() is a single load of
+// GPIO.in or GPIO.in1 on the ESP32, and level() picks a pin out of it, so
+// all of them are seen at the same instant for the cost of one.
+template <uint8_t First, uint8_t... Rest>
+class GpioInputBank {
+  static_assert(gpioAllInputs(First, Rest...), "not an input-capable GPIO");
+  static_assert(gpioSameBank(First, Rest...), "pins must share a bank (0-31 or 32-39)");
+
+ public:
+  static uint32_t read() {
+#if defined(ESP32)
+    return First < 32 ? GPIO.in : GPIO.in1.val;
+#else
+    uint32_t word = 0;
+    int expand[] = { 0, (word |= (uint32_t)halDigitalRead(First) << (First & 31), 0),
+                     (word |= (uint32_t)halDigitalRead(Rest) << (Rest & 31), 0)... };
+    (void)expand;
+    return word;
+#endif
+  }
+
+  template <uint8_t Pin>
+  static bool level(uint32_t word) {
+    static_assert(!gpioNoneEqual(Pin, First, Rest...), "pin is not in this bank");
+    return (word >> (Pin & 31)) & 1;
+  }
+};
+
+// The board's digital I/O
+typedef GpioOutput<Board::relayPin> RelayOutput;
+typedef GpioOutput<Board::buzzerPin> BuzzerOutput;
+typedef GpioInput<Board::menuButtonPin> MenuButtonInput;
+typedef GpioInput<Board::plusButtonPin> PlusButtonInput;
+typedef GpioInput<Board::minusButtonPin> MinusButtonInput;
+typedef GpioInputBank<Board::menuButtonPin, Board::plusButtonPin, Board::minusButtonPin>
+    ButtonInputs;
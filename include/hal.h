@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+// Thin hardware abstraction for the controller: clock, GPIO/ADC, the
+// 16x2 display, key/value storage and a GET-only HTTP server.
+// src/hal_esp32.cpp implements it on Arduino-ESP32 (millis, LiquidCrystal_I2C,
+// Preferences, WebServer); src/hal_native.cpp on Linux for [env:native].
+
+// Functions called from interrupt handlers must live in IRAM on the ESP32
+// and state kept through deep sleep in RTC slow memory
+#if defined(ESP32)
+#include <esp_attr.h>
+#else
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#endif
+
+// Clock
+uint32_t halMillis();
+uint64_t halMicros();
+
+// GPIO and ADC
+enum HalPinMode {
+  HAL_INPUT,
+  HAL_INPUT_PULLUP,
+  HAL_OUTPUT
+};
+
+typedef void (*HalIsr)();
+
+void halPinMode(int pin, HalPinMode mode);
+void halDigitalWrite(int pin, bool high);
+bool halDigitalRead(int pin);
+uint16_t halAnalogRead(int pin);
+void halAttachFallingEdge(int pin, HalIsr isr);
+
+// 16x2 character display. Rows are padded to the full width so a shorter
+// text overwrites the previous one without clearing (and flickering).
+static const int halDisplayColumns = 16;
+static const int halDisplayRows = 2;
+
+void halDisplayBegin();
+void halDisplayLine(uint8_t row, const char* text);
+void halDisplayBacklight(bool on);
+
+// Key/value storage in one namespace (NVS on the ESP32)
+void halStorageBegin(const char* ns);
+int32_t halStorageGetInt(const char* key, int32_t fallback);
+void halStoragePutInt(const char* key, int32_t value);
+uint32_t halStorageGetUInt(const char* key, uint32_t fallback);
+void halStoragePutUInt(const char* key, uint32_t value);
+
+// Blobs of up to halStorageBlobBytes. Get returns the stored length, 0 when
+// absent or larger than `size`.
+static const size_t halStorageBlobBytes = 1536;
+
+size_t halStorageGetBytes(const char* key, void* out, size_t size);
+void halStoragePutBytes(const char* key, const void* data, size_t length);
+void halStorageRemove(const char* key);
+
+// HTTP server, GET only, with routes added after halHttpBegin(). Handlers
+// run inside halHttpPoll() and answer with exactly one halHttpSend() or a
+// halHttpBeginChunked() ... halHttpEndChunked() sequence.
+typedef std::function<void()> HalHttpHandler;
+
+void halHttpBegin(uint16_t port);
+void halHttpOn(const char* path, HalHttpHandler handler);
+void halHttpPoll();
+
+// Copies a query argument into `out`; false if it is absent
+bool halHttpArg(const char* name, char* out, size_t size);
+
+void halHttpSend(int code, const char* type, const char* body, size_t length);
+void halHttpBeginChunked(const char* type);
+void halHttpSendChunk(const char* data, size_t length);
+void halHttpEndChunked();
+
+// One outgoing TCP connection. halTcpConnect() blocks for at most
+// `timeoutMs`; reads never block and return 0 when nothing is pending, -1
+// once the peer has closed. halTcpLinkUp() is false while the station has
+// no network to reach a server through (always true on Linux).
+bool halTcpLinkUp();
+bool halTcpConnect(const char* host, uint16_t port, uint32_t timeoutMs);
+bool halTcpWrite(const uint8_t* data, size_t length);
+int halTcpRead(uint8_t* out, size_t size);
+void halTcpClose();
+
+// Console (Serial on the ESP32, stdout on Linux) and the internal heap's
+// free bytes and largest allocatable block (both 0 on Linux)
+void halPrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+uint32_t halFreeHeap();
+uint32_t halLargestFreeBlock();
+
+// Power. The CPU clock is never scaled: cycle-counter timings (latency
+// histograms, route and event traces) are converted at the current
+// frequency. halLightSleep() stops both cores for up to `us`, waking early
+// on a low level at any pin with a falling-edge handler; that handler then
+// runs as if the edge had been seen. A handler pin already low, or a chip
+// that refuses, means no sleep (HAL_WAKE_NONE, always on Linux).
+enum HalWakeCause {
+  HAL_WAKE_NONE,
+  HAL_WAKE_TIMER,
+  HAL_WAKE_GPIO
+};
+
+HalWakeCause halLightSleep(uint64_t us);
+
+// Deep sleep restarts the app at setup(); only RTC_DATA_ATTR variables and
+// held output levels survive. halRtcMicros() keeps counting through it.
+// The wake cause is HAL_WAKE_NONE after power-on or reset, HAL_WAKE_GPIO
+// for `wakePin` pulled low. Linux has no RTC domain: the process exits.
+uint64_t halRtcMicros();
+HalWakeCause halDeepSleepWakeCause();
+void halHoldOutput(int pin, bool hold);
+void halDeepSleep(uint64_t us, int wakePin) __attribute__((noreturn));
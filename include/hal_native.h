@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// Test-bench side of the Linux HAL (src/hal_native.cpp): drives the inputs
+// the ESP32 would read from hardware and exposes what it would show.
+
+static const int nativePinCount = 40;
+
+// Value returned by halAnalogRead(pin); 12-bit like the ESP32 ADC
+void nativeSetAnalog(int pin, uint16_t value);
+
+// Level seen by halDigitalRead(pin). A high to low change runs the pin's
+// halAttachFallingEdge() handler, as the GPIO interrupt would.
+void nativeSetDigital(int pin, bool high);
+
+// Pulses for the pin's counter (PCNT on the ESP32), taken by the driver
+void nativeAddPulses(int pin, uint32_t pulses);
+uint32_t nativeTakePulses(int pin);
+
+// Current display text, padded to the display width
+const char* nativeDisplayLine(int row);
+
+// Simulation support: a clock that only moves through nativeAdvanceClock(),
+// storage that starts empty and never touches ./<ns>.nvs, and no console
+// or LCD echo on stdout
+void nativeUseVirtualClock();
+void nativeAdvanceClock(uint32_t ms);
+void nativeUseMemoryStorage();
+void nativeSetQuiet(bool quiet);
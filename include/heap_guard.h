@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "task_manager.h"
+#include "text_buffer.h"
+
+// Post-boot allocation tracking.
+//
+// Built with -DHEAP_GUARD (see [env:esp32dev-heapguard]) malloc, calloc and
+// realloc are wrapped at link time. Once heapGuardArm() has been called every
+// allocation is counted against the calling task and its caller address is
+// kept in a small ring. With -DHEAP_GUARD_STRICT an allocation from the
+// control or UI task aborts with a backtrace, since those paths must be
+// allocation-free; the network task is only counted because WebServer builds
+// its headers in String.
+//
+// Allocations made directly through heap_caps_malloc() (WiFi driver
+// internals) don't go through malloc and aren't seen.
+
+void heapGuardArm();
+bool heapGuardEnabled();
+
+// Post-boot allocations made by a task, 0 when the guard is compiled out
+uint32_t heapGuardAllocations(TaskId task);
+
+// Heap watermarks plus, when enabled, post-boot allocation counts
+void heapGuardJson(TextBuffer& out);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "seqlock.h"
+#include "task_manager.h"
+#include "text_buffer.h"
+
+// Long-running memory health.
+//
+// sample() records free heap, the largest free block, the fragmentation
+// ratio (1 - largest / free) and every task's stack high-water mark into a
+// 64-entry trend ring, one entry per call (the UI task calls it once a
+// minute, so the ring holds about an hour). Each evaluation raises warnings
+// for:
+//  - a largest free block under warnBlockBytes: WebServer's String
+//    parsing and the WiFi driver need contiguous blocks of a few KB
+//  - fragmentation at or above warnFragmentationPermille
+//  - a largest block shrinking fast enough to reach criticalBlockBytes
+//    within warnHorizonHours, from a least-squares fit over the ring
+//  - a task with fewer than warnStackBytes of stack never touched
+//
+// Hosts report no heap or stack figures (0), and those checks are skipped.
+enum HeapWarning : uint8_t {
+  HEAP_WARN_LOW_BLOCK = 1 << 0,
+  HEAP_WARN_FRAGMENTED = 1 << 1,
+  HEAP_WARN_SHRINKING = 1 << 2,
+  HEAP_WARN_STACK = 1 << 3,
+};
+
+struct HeapTrendEntry {
+  uint32_t timeS;            // uptime
+  uint32_t freeBytes;
+  uint32_t largestBlock;
+  uint16_t fragmentationPermille;
+  uint16_t stackFree[TASK_COUNT];
+};
+
+struct HeapHealth {
+  HeapTrendEntry latest;
+  uint32_t minFreeBytes;     // since boot
+  uint32_t minLargestBlock;
+  int32_t blockSlopePerHour; // largest-block trend over the ring, bytes
+  uint8_t warnings;          // HeapWarning bits
+  uint32_t samples;
+};
+
+class HeapMonitor {
+ public:
+  static const int trendSize = 64;
+  static const uint32_t warnBlockBytes = 16384;
+  static const uint32_t criticalBlockBytes = 4096;
+  static const uint16_t warnFragmentationPermille = 500;
+  static const uint32_t warnHorizonHours = 24;
+  static const uint32_t warnStackBytes = 512;
+
+  HeapMonitor();
+
+  // One writer task only. Returns the warning bits newly raised by this
+  // sample, so the caller can announce them once.
+  uint8_t sample(uint32_t nowSeconds);
+
+  // Any task
+  HeapHealth health() const { return health_.read(); }
+  void json(TextBuffer& out) const;
+
+  static const char* warningText(uint8_t warnings);
+
+ private:
+  int32_t blockSlopePerHour() const;
+
+  // Writer-side copy; readers go through the seqlocks
+  HeapTrendEntry trend_[trendSize];
+  uint32_t head_;
+  HeapHealth state_;
+
+  Seqlock<HeapTrendEntry> published_[trendSize];
+  Seqlock<HeapHealth> health_;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "cycle_counter.h"
+#include "text_buffer.h"
+
+// Log-bucketed histogram of cycle counts: each power of two is split into
+// four linear sub-buckets, so percentiles are within 25 % across the full
+// 32-bit range in 124 counters. Recording is a handful of instructions.
+//
+// One writer task per histogram. Readers on other tasks see counters that
+// may be a few records apart, which is fine for reporting.
+class LatencyHistogram {
+ public:
+  static const int subBits = 2;
+  static const int bucketCount = (32 - subBits + 1) << subBits;
+
+  explicit LatencyHistogram(const char* name);
+
+  void record(uint32_t cycles) {
+    buckets_[bucketOf(cycles)]++;
+    count_++;
+    if (cycles > max_) max_ = cycles;
+  }
+
+  void reset();
+
+  const char* name() const { return name_; }
+  uint32_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+
+  // Upper bound (cycles) of the bucket holding the given percentile,
+  // capped at max()
+  uint32_t percentile(uint32_t permille) const;
+
+ private:
+  static int bucketOf(uint32_t cycles) {
+    if (cycles < (1u << subBits)) {
+      return cycles;
+    }
+    int msb = 31 - __builtin_clz(cycles);
+    int sub = (cycles >> (msb - subBits)) & ((1 << subBits) - 1);
+    return ((msb - subBits + 1) << subBits) | sub;
+  }
+
+  static uint32_t upperBound(int bucket);
+
+  const char* name_;
+  volatile uint32_t buckets_[bucketCount];
+  volatile uint32_t count_;
+  volatile uint32_t max_;
+};
+
+// Records the cycles between construction and destruction
+class LatencyScope {
+ public:
+  explicit LatencyScope(LatencyHistogram& histogram)
+      : histogram_(histogram), start_(cycleCount()) {}
+  ~LatencyScope() { histogram_.record(cycleCount() - start_); }
+
+ private:
+  LatencyHistogram& histogram_;
+  uint32_t start_;
+};
+
+// Instrumented sections. The first three are whole task iterations
+// (recorded by taskBusyEnd()) and line up with TaskId.
+enum LatencySection {
+  LAT_NETWORK_ITERATION = 0,
+  LAT_CONTROL_ITERATION,
+  LAT_UI_ITERATION,
+  LAT_HANDLE_CLIENT,
+  LAT_SAMPLING,
+  LAT_IRRIGATION,
+  LAT_MENU,
+  LAT_DISPLAY,
+  LAT_PREF_COMMIT,
+  LAT_SECTION_COUNT
+};
+
+LatencyHistogram& latency(LatencySection section);
+
+// p50/p99/max in microseconds for every section
+void latencyJson(TextBuffer& out);
+void latencyReport();   // same, on Serial
+void latencyReset();
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "moisture_sample.h"
+
+// One decoded history point
+struct HistoryPoint {
+  uint32_t time;     // seconds since boot
+  uint8_t percent;
+  uint8_t flags;     // SAMPLE_* bits
+};
+
+// Compressed one-second moisture history, Gorilla style.
+//
+// Points are packed into fixed 256 byte blocks that are recycled oldest
+// first. Inside a block the timestamp is stored as a delta-of-delta and the
+// value (percent plus flags) as an XOR against the previous value. A point
+// whose interval and value both repeat costs a single bit, so stable soil at
+// the 1 Hz control rate stays close to 1 bit per point and the default 40 KB
+// holds several days.
+//
+// Each block's first point and time range are kept in a separate index, so
+// a read locates its start block by binary search and only decodes from
+// there. Not thread safe: one task appends and reads.
+class MoistureHistory {
+ public:
+  static const size_t blockBytes = 256;
+  static const size_t blockCount = 160;
+
+  struct BlockInfo {
+    uint32_t firstTime;
+    uint32_t lastTime;
+    uint16_t firstValue;
+    uint16_t count;    // points, including the one held in the index
+    uint16_t bits;     // payload bits written
+  };
+
+  // Streaming decoder over the blocks present when it was created. Appending
+  // while a reader is live is allowed; blocks recycled under it end the read.
+  class Reader {
+   public:
+    bool next(HistoryPoint& out);
+
+   private:
+    friend class MoistureHistory;
+    Reader(const MoistureHistory* history, size_t block, uint32_t from);
+
+    bool loadBlock();
+
+    const MoistureHistory* history_;
+    uint32_t from_;
+    uint32_t generation_;   // block sequence number being decoded
+    uint16_t point_;        // next point index within the block
+    uint16_t bitPos_;
+    uint32_t time_;
+    uint32_t delta_;
+    uint16_t value_;
+    uint8_t leading_;
+    uint8_t trailing_;
+  };
+
+  MoistureHistory();
+
+  // Returns the point's time in seconds since boot
+  uint32_t append(const MoistureSample& sample);
+
+  // Points with time >= `from`, oldest first
+  Reader read(uint32_t from) const;
+
+  uint32_t points() const { return points_; }
+  size_t blocks() const { return used_; }
+  uint32_t oldestTime() const;
+  uint32_t newestTime() const;
+
+  // Payload plus index bits per stored point, x100
+  uint32_t centibitsPerPoint() const;
+
+ private:
+  // Worst case encoding of one point: 2 + (2 + 32) + (1 + 1 + 4 + 4 + 16)
+  static const uint16_t maxPointBits = 62;
+
+  size_t physical(size_t ordinal) const;
+  void startBlock(uint32_t time, uint16_t value);
+  void encodeValue(uint8_t* data, uint16_t x);
+
+  uint8_t data_[blockCount][blockBytes];
+  BlockInfo index_[blockCount];
+
+  size_t newest_;          // physical slot being written
+  size_t used_;
+  uint32_t generation_;    // blocks started since boot, oldest = generation_ - used_
+  uint32_t points_;        // points currently stored
+  uint64_t elapsedMs_;     // wrap-free millis() of the last append
+  uint32_t lastMs_;
+
+  // Encoder state for the newest block
+  uint32_t time_;
+  uint32_t delta_;
+  uint16_t value_;
+  uint8_t leading_;
+  uint8_t trailing_;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "fixed_point.h"
+
+#if defined(ESP32)
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+#endif
+
+// Probe readings at the dry (0 %) and wet (100 %) ends, in driver units
+struct ProbeCalibration {
+  int32_t dry;
+  int32_t wet;
+};
+
+// Shared by every driver: linear between the calibration points, clamped
+// to 0..100, keeping the fraction of a percent for filtering
+Fixed16 calibratedMoisture(uint32_t reading, const ProbeCalibration& calibration);
+
+// Whole percent as displayed and compared to the threshold. Rounded as the
+// firmware always has, 100 - map(reading, wet, dry, 0, 100), so the stock
+// ADC build switches at the same readings.
+int calibratedPercent(uint32_t reading, const ProbeCalibration& calibration);
+
+// Resistive/analog capacitive probe on an ADC pin, averaged over a burst.
+// Readings are ADC counts.
+class AnalogProbe {
+ public:
+  AnalogProbe(int pin, int burstSize);
+
+  bool begin();
+  uint32_t read();
+
+  static const ProbeCalibration defaultCalibration;
+
+ private:
+  int pin_;
+  int burstSize_;
+};
+
+#if defined(ESP32)
+// Oscillator-output capacitive probe. A PCNT unit counts rising edges in
+// hardware and a periodic esp_timer closes each gate, so sampling costs one
+// counter read per gate. Gates are timed with the actual elapsed
+// microseconds and smoothed with an EMA in Q16.16 kHz, so the gate callback
+// does no float work. Readings are Hz; wetter soil means more capacitance
+// and a lower frequency.
+//
+// The 16-bit counter wraps at 32767 and is read as a delta, so a gate must
+// see fewer edges than that: up to ~320 kHz at the default 100 ms.
+class FrequencyProbe {
+ public:
+  FrequencyProbe(int pin, pcnt_unit_t unit, uint32_t gateMs = 100);
+
+  bool begin();
+  uint32_t read() const { return hz_.load(std::memory_order_relaxed); }
+  uint32_t gates() const { return gates_.load(std::memory_order_relaxed); }
+
+  static const ProbeCalibration defaultCalibration;
+
+ private:
+  static const int16_t counterLimit = INT16_MAX;
+  static constexpr Fixed16 smoothing = Fixed16::fromFloat(0.2f);   // EMA weight of each gate
+
+  static void onGate(void* arg);
+
+  int pin_;
+  pcnt_unit_t unit_;
+  uint32_t gateMs_;
+  esp_timer_handle_t timer_;
+
+  // esp_timer task
+  int16_t lastCount_;
+  int64_t lastGateUs_;
+  Fixed16 filteredKhz_;
+  std::atomic<uint32_t> hz_;
+  std::atomic<uint32_t> gates_;
+};
+#endif
+
+#ifdef MOISTURE_PROBE_FREQUENCY
+typedef FrequencyProbe MoistureProbe;
+#else
+typedef AnalogProbe MoistureProbe;
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fixed_point.h"
+#include "moisture_sample.h"
+
+// Aggregate of every sample whose time falls in one bucket
+struct RollupBucket {
+  uint32_t count;         // 0 for a bucket with no samples (gap)
+  uint32_t sum;           // of percent
+  uint32_t pumpSeconds;   // relay-on time
+  uint8_t min;
+  uint8_t max;
+
+  Fixed16 mean() const { return Fixed16::ratio(sum, count); }
+};
+
+// Fixed ring of consecutive buckets at one resolution. Bucket starts are
+// aligned to the resolution and implied by position, so a gap in the input
+// leaves empty buckets rather than shifting the ring.
+class RollupRing {
+ public:
+  RollupRing(uint32_t resolution, RollupBucket* buckets, uint16_t capacity);
+
+  // O(1), apart from clearing buckets skipped by a gap in `time`
+  void add(uint32_t time, uint8_t percent, uint32_t pumpSeconds);
+
+  uint32_t resolution() const { return resolution_; }
+  uint16_t capacity() const { return capacity_; }
+  uint16_t size() const { return size_; }
+
+  // Oldest (0) to newest (size() - 1)
+  const RollupBucket& at(uint16_t i) const;
+  uint32_t startOf(uint16_t i) const;
+
+  // First bucket index covering or after `time`
+  uint16_t find(uint32_t time) const;
+
+ private:
+  RollupBucket* buckets_;
+  uint32_t resolution_;
+  uint16_t capacity_;
+  uint16_t size_;
+  uint16_t newest_;        // physical index of the open bucket
+  uint32_t newestStart_;
+};
+
+// 1 minute, 15 minute, 1 hour and 1 day rollups of the sample stream.
+//
+// Every sample updates the open bucket of each level directly (four O(1)
+// updates) instead of cascading closed buckets upward, so coarse levels
+// also include the minute that is still in progress.
+class MoistureRollups {
+ public:
+  enum Level {
+    ROLLUP_1M = 0,
+    ROLLUP_15M,
+    ROLLUP_1H,
+    ROLLUP_1D,
+    ROLLUP_LEVELS
+  };
+
+  // Relay-on time is only counted across gaps up to this long
+  static const uint32_t maxPumpGap = 10;
+
+  MoistureRollups();
+
+  // `time` in seconds since boot, non-decreasing
+  void append(uint32_t time, const MoistureSample& sample);
+
+  const RollupRing& level(int level) const { return rings_[level]; }
+
+  // Finest level that reaches back to `from` (or to boot) with at most
+  // `maxPoints` buckets between `from` and `to`; the coarsest otherwise
+  const RollupRing& select(uint32_t from, uint32_t to, uint32_t maxPoints) const;
+
+ private:
+  RollupBucket minutes_[720];    // 12 hours
+  RollupBucket quarters_[192];   // 2 days
+  RollupBucket hours_[168];      // 1 week
+  RollupBucket days_[92];        // 3 months
+  RollupRing rings_[ROLLUP_LEVELS];
+
+  uint32_t lastTime_;
+  bool lastRelayOn_;
+  bool started_;
+};
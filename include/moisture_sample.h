@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sample_ring.h"
+
+// One acquisition as published by the control task
+struct MoistureSample {
+  uint32_t timeMs;   // millis() at acquisition
+  uint32_t raw;      // probe units: ADC counts or Hz
+  uint8_t percent;   // 0..100 after calibration
+  uint8_t flags;     // SAMPLE_* bits, outputs in force when sampled
+};
+
+enum SampleFlags {
+  SAMPLE_RELAY_ON = 1 << 0,
+  SAMPLE_BUZZER_ON = 1 << 1,
+  SAMPLE_WIFI_MODE = 1 << 2,
+};
+
+// Consumers of the sample stream, one cursor each
+enum SampleReader {
+  READER_CONTROL = 0,
+  READER_WEB,
+  READER_HISTORY,
+  SAMPLE_READER_COUNT
+};
+
+// 64 entries is a minute of slack for each reader at the 1 s control rate
+typedef SampleRing<MoistureSample, 64, SAMPLE_READER_COUNT> MoistureSampleRing;
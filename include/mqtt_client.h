@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal MQTT 3.1.1 client on the HAL's TCP connection: CONNECT with a
+// retained last will, PUBLISH at QoS 0 or 1 with at most one QoS 1 message
+// in flight, SUBSCRIBE, keep-alive pings, and inbound PUBLISH at QoS 0/1.
+// Packets are built and parsed in fixed buffers; nothing is allocated.
+// Network task only.
+class MqttClient {
+ public:
+  static const size_t txBytes = 2048;
+  static const size_t rxBytes = 512;
+
+  typedef void (*MessageHandler)(const char* topic, const char* payload, size_t length,
+                                 void* arg);
+
+  MqttClient();
+
+  void setHandler(MessageHandler handler, void* arg);
+
+  // Blocks up to `timeoutMs` for the TCP connect, then sends CONNECT;
+  // connected() turns true when poll() sees the CONNACK. The will is
+  // published retained by the broker if the link drops.
+  bool connect(const char* host, uint16_t port, const char* clientId, uint16_t keepAliveS,
+               const char* willTopic, const char* willPayload, uint32_t timeoutMs);
+  void disconnect();
+  bool open() const { return open_; }
+  bool connected() const { return connected_; }
+
+  bool subscribe(const char* topic, uint8_t qos);
+
+  // QoS 1 fails while another QoS 1 message is unacknowledged. `dup` marks
+  // a retransmission after reconnecting.
+  bool publish(const char* topic, const char* payload, size_t length, uint8_t qos,
+               bool retain, bool dup = false);
+
+  // Packet id of the QoS 1 publish awaiting PUBACK, 0 when none
+  uint16_t inflight() const { return inflight_; }
+
+  // Reads and dispatches whatever has arrived and keeps the session alive.
+  // Returns false once the connection is gone.
+  bool poll(uint32_t nowMs);
+
+ private:
+  bool beginPacket(uint8_t header, size_t remaining);
+  void putByte(uint8_t b) { tx_[txLength_++] = b; }
+  void putU16(uint16_t v);
+  void putString(const char* s, size_t length);
+  bool sendPacket();
+  bool readPackets();
+  void handlePacket(uint8_t header, const uint8_t* body, size_t length);
+  uint16_t nextPacketId();
+  void drop();
+
+  MessageHandler handler_;
+  void* handlerArg_;
+
+  bool open_;
+  bool connected_;
+  uint32_t keepAliveMs_;
+  uint16_t lastPacketId_;
+  uint16_t inflight_;
+  uint32_t lastTxMs_;
+  uint32_t pingSentMs_;     // 0 when no PINGRESP is outstanding
+
+  uint8_t tx_[txBytes];
+  size_t txLength_;
+  uint8_t rx_[rxBytes];
+  size_t rxLength_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+// ESP32 GPIO capabilities, for the board checks below
+constexpr bool gpioExists(int pin) {
+  return pin >= 0 && pin <= 39 && pin != 20 && pin != 24 && !(pin >= 28 && pin <= 31);
+}
+constexpr bool gpioIsFlash(int pin) { return pin >= 6 && pin <= 11; }   // module SPI flash
+constexpr bool gpioCanInput(int pin) { return gpioExists(pin) && !gpioIsFlash(pin); }
+constexpr bool gpioCanOutput(int pin) { return gpioCanInput(pin) && pin < 34; }
+// ADC2 is taken over by the WiFi driver; only ADC1 reads while the radio is on
+constexpr bool gpioIsAdc1(int pin) { return pin >= 32 && pin <= 39; }
+// Usable as the ext0 deep-sleep wake source
+constexpr bool gpioIsRtc(int pin) {
+  return pin == 0 || pin == 2 || pin == 4 || (pin >= 12 && pin <= 15) ||
+         (pin >= 25 && pin <= 27) || (pin >= 32 && pin <= 39);
+}
+// Sampled at reset; a load on them can change the boot mode
+constexpr bool gpioIsStrapping(int pin) {
+  return pin == 0 || pin == 2 || pin == 5 || pin == 12 || pin == 15;
+}
+
+constexpr bool gpioNoneEqual(int) { return true; }
+template <typename... Pins>
+constexpr bool gpioNoneEqual(int pin, int first, Pins... rest) {
+  return pin != first && gpioNoneEqual(pin, rest...);
+}
+constexpr bool gpioDistinct() { return true; }
+template <typename... Pins>
+constexpr bool gpioDistinct(int first, Pins... rest) {
+  return gpioNoneEqual(first, rest...) && gpioDistinct(rest...);
+}
+
+// The controller board: every GPIO the firmware touches, in one place.
+// Drivers are instantiated from these (see gpio.h), so a pin that can't do
+// its job fails the build instead of misbehaving on the bench.
+struct DevKitBoard {
+  static constexpr uint8_t moisturePin = 34;
+  static constexpr uint8_t relayPin = 14;
+  static constexpr uint8_t buzzerPin = 25;
+
+  static constexpr uint8_t menuButtonPin = 32;
+  static constexpr uint8_t plusButtonPin = 33;
+  static constexpr uint8_t minusButtonPin = 35;
+  // GPIO34-39 have no internal pullups; MINUS relies on the board's resistor
+
+  // Hall-effect flow meter, counted by PCNT unit 0
+  static constexpr uint8_t flowMeterPin = 27;
+
+  // LCD backpack on Wire's default pins
+  static constexpr uint8_t lcdSdaPin = 21;
+  static constexpr uint8_t lcdSclPin = 22;
+};
+
+typedef DevKitBoard Board;
+
+static_assert(gpioDistinct(Board::moisturePin, Board::relayPin, Board::buzzerPin,
+                           Board::menuButtonPin, Board::plusButtonPin, Board::minusButtonPin,
+                           Board::flowMeterPin, Board::lcdSdaPin, Board::lcdSclPin),
+              "two functions share a GPIO");
+#if defined(MOISTURE_PROBE_FREQUENCY)
+static_assert(gpioCanInput(Board::moisturePin), "frequency probe needs an input pin");
+#else
+static_assert(gpioIsAdc1(Board::moisturePin),
+              "moisture probe must be on ADC1 (GPIO32-39): ADC2 can't be read with WiFi on");
+#endif
+static_assert(!gpioIsStrapping(Board::relayPin) && !gpioIsStrapping(Board::buzzerPin),
+              "relay and buzzer must not load a strapping pin");
+static_assert(gpioIsRtc(Board::menuButtonPin), "the menu button wakes field mode (ext0)");
+static_assert(gpioCanInput(Board::flowMeterPin), "flow meter needs an input pin");
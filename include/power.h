@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "task_manager.h"
+#include "text_buffer.h"
+
+// Light sleep between deadlines.
+//
+// The control and UI tasks report how long they are about to block; when
+// both are blocked the ESP32 idle hook calls powerIdle(), which light-sleeps
+// until the earlier deadline (or a button press) unless something holds the
+// chip awake:
+//  - the radio: a softAP has to beacon and can't use modem sleep, so while
+//    it is up the CPU just idles between interrupts
+//  - the pump: the flow meter's PCNT is clock-gated in light sleep and
+//    would miss pulses
+//  - the frequency probe (MOISTURE_PROBE_FREQUENCY): its PCNT unit stops
+//    too while the esp_timer gate keeps running, so a gate spanning a sleep
+//    would read far too few Hz and the soil as wet. Held while it runs.
+//
+// Current is not measured on the board; powerStatsJson() estimates it from
+// the time spent in each state and the typical datasheet figures below.
+// Check them against a shunt on real hardware.
+enum PowerHold : uint8_t {
+  POWER_HOLD_RADIO = 1 << 0,
+  POWER_HOLD_PUMP = 1 << 1,
+  POWER_HOLD_PROBE = 1 << 2,
+};
+
+static const float powerActiveMa = 50;       // CPU busy at 240 MHz
+static const float powerIdleMa = 20;         // awake, waiting for an interrupt
+static const float powerLightSleepMa = 0.8f;
+static const float powerRadioMa = 100;       // softAP on top of the CPU, averaged
+
+// Sleeps shorter than this cost more in wake-up than they save
+static const uint32_t powerMinSleepUs = 3000;
+
+void powerBegin();
+
+// Called by each task before it blocks for `ms`, and when it runs again
+void powerTaskBlocking(TaskId task, uint32_t ms);
+void powerTaskRunning(TaskId task);
+
+// Any task; POWER_HOLD_RADIO only from the network task (or setup() before
+// it starts), which also owns the radio-on time and powerStatsJson()
+void powerHold(PowerHold reason, bool held);
+
+// Idle hook body; true when the chip slept (the blocked tasks' tick-based
+// timeouts did not advance meanwhile, so the caller must wake them)
+bool powerIdle();
+
+void powerStatsJson(TextBuffer& out);
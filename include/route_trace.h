@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "text_buffer.h"
+
+struct RouteStats {
+  const char* path;
+  uint32_t requests;
+  uint64_t totalCycles;     // handler time
+  uint32_t maxCycles;
+  uint64_t responseBytes;   // bodies as passed to the send helpers
+  int32_t heapDelta;        // free-heap change summed over requests
+  int32_t worstHeapDelta;   // largest single drop (negative)
+  uint32_t allocations;     // malloc calls, HEAP_GUARD builds only
+};
+
+// Per-route request accounting in a fixed table. Handlers are bracketed by
+// begin()/end(); the send helpers report body bytes in between. Network
+// task only.
+class RouteTracer {
+ public:
+  static const int maxRoutes = 24;
+
+  RouteTracer();
+
+  // Returns the route's slot, -1 when the table is full (not traced)
+  int add(const char* path);
+
+  void begin(int route);
+  void end();
+  void addBytes(size_t bytes);
+
+  // Routes ordered as registered, with their share of all handler time
+  void json(TextBuffer& out) const;
+
+ private:
+  RouteStats routes_[maxRoutes];
+  int count_;
+
+  int current_;
+  uint32_t startCycles_;
+  uint32_t startFreeHeap_;
+  uint32_t startAllocations_;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+
+// ESP32 flash cache lines are 32 bytes; hosts are 64
+#ifndef CACHE_LINE_SIZE
+#if defined(ESP32)
+#define CACHE_LINE_SIZE 32
+#else
+#define CACHE_LINE_SIZE 64
+#endif
+#endif
+
+// Lock-free single-producer ring with several independent readers.
+//
+// The producer never waits: when a reader falls more than Capacity - 1
+// entries behind, its oldest entries are overwritten and counted as overruns
+// for that reader only. Each reader owns its cursor, so readers don't contend
+// with the producer or with each other. A reader validates every copy
+// against the head afterwards and retries if the producer lapped it
+// mid-copy, so T must be trivially copyable.
+template <typename T, size_t Capacity, size_t Readers>
+class SampleRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SampleRing capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SampleRing entries are copied without locks");
+
+ public:
+  SampleRing() : head_(0) {}
+
+  // Producer side, one task only
+  void push(const T& value) {
+    uint32_t h = head_.load(std::memory_order_relaxed);
+    // Keep the slot overwrite after the previous head publication so a
+    // validating reader can't miss it
+    std::atomic_thread_fence(std::memory_order_release);
+    slots_[h & mask] = value;
+    head_.store(h + 1, std::memory_order_release);
+  }
+
+  // Reader side, one task per reader index. Returns false when caught up.
+  bool pop(size_t reader, T& out) {
+    Cursor& c = readers_[reader];
+    for (;;) {
+      uint32_t h = head_.load(std::memory_order_acquire);
+      uint32_t tail = c.position;
+      if (h == tail) {
+        return false;
+      }
+      if (h - tail >= Capacity) {
+        // Lapped: skip to the oldest entry that can't be overwritten yet
+        uint32_t oldest = h - (Capacity - 1);
+        c.overruns += oldest - tail;
+        tail = oldest;
+      }
+
+      out = slots_[tail & mask];
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (head_.load(std::memory_order_relaxed) - tail >= Capacity) {
+        c.position = tail;  // torn copy, the loop accounts for the overrun
+        continue;
+      }
+      c.position = tail + 1;
+      return true;
+    }
+  }
+
+  // Drain a reader and keep only the newest entry
+  bool popLatest(size_t reader, T& out) {
+    bool any = false;
+    while (pop(reader, out)) {
+      any = true;
+    }
+    return any;
+  }
+
+  // Skip everything published so far, e.g. when a consumer (re)starts
+  void attach(size_t reader) {
+    readers_[reader].position = head_.load(std::memory_order_acquire);
+  }
+
+  uint32_t available(size_t reader) const {
+    uint32_t pending = head_.load(std::memory_order_acquire) - readers_[reader].position;
+    return pending >= Capacity ? Capacity - 1 : pending;
+  }
+
+  uint32_t overruns(size_t reader) const { return readers_[reader].overruns; }
+  uint32_t published() const { return head_.load(std::memory_order_acquire); }
+
+  static constexpr size_t capacity() { return Capacity; }
+  static constexpr size_t readers() { return Readers; }
+
+ private:
+  static constexpr uint32_t mask = Capacity - 1;
+
+  // Reader cursors sit on their own cache lines so they never false-share
+  // with the head or with each other
+  struct alignas(CACHE_LINE_SIZE) Cursor {
+    uint32_t position = 0;
+    uint32_t overruns = 0;
+  };
+
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head_;
+  alignas(CACHE_LINE_SIZE) Cursor readers_[Readers];
+  alignas(CACHE_LINE_SIZE) T slots_[Capacity];
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+
+// Single-writer sequence lock for small trivially copyable values. The
+// writer never waits; readers copy and retry if a write overlapped.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock values are copied without locks");
+
+ public:
+  Seqlock() : sequence_(0), value_() {}
+
+  // One writer task only
+  void write(const T& value) {
+    uint32_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);  // odd while writing
+    std::atomic_thread_fence(std::memory_order_release);
+    value_ = value;
+    sequence_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Any task, lock-free
+  T read() const {
+    T copy;
+    uint32_t before, after;
+    do {
+      before = sequence_.load(std::memory_order_acquire);
+      copy = value_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copy;
+  }
+
+ private:
+  std::atomic<uint32_t> sequence_;
+  T value_;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+// Single-bucket soil water balance for the host simulator
+// (main_native.cpp --simulate). Stepped once per simulated second:
+//
+//   storage += rain + pump - ET - drainage, runoff above saturation
+//
+// ET follows FAO-56: a seasonal reference ET0 shaped over daylight hours,
+// reduced linearly once the readily available water is used up. Water above
+// field capacity drains with a fixed time constant. Rain comes from a seeded
+// xorshift generator, so a given seed replays the same season.
+struct SoilConfig {
+  float rootDepthMm = 300;
+  float saturation = 0.45f;      // volumetric water content (m3/m3)
+  float fieldCapacity = 0.30f;
+  float wiltingPoint = 0.12f;
+  float initialContent = 0.25f;
+  float depletionFraction = 0.5f;  // FAO-56 p: no stress until this is used
+  float drainageHours = 24;
+
+  // Seasonal ET0, lowest at the start and end, peaking mid-season
+  uint32_t seasonDays = 180;
+  float et0MinMmPerDay = 2;
+  float et0MaxMmPerDay = 6;
+  float cropCoefficient = 1;
+
+  // One storm at most per day
+  float rainChance = 0.25f;
+  float rainMeanMm = 8;
+  float rainMmPerHour = 4;
+
+  // Drip line over the bed; 1 L over 1 m2 is 1 mm
+  float pumpLitersPerMinute = 2;
+  float bedAreaM2 = 1;
+
+  uint32_t seed = 1;
+};
+
+struct SoilTotals {
+  double rainMm;
+  double pumpLiters;
+  double etMm;
+  double drainageMm;
+  double runoffMm;
+  uint32_t secondsBelowWilting;
+  uint32_t secondsStressed;     // below the readily available water
+};
+
+class SoilModel {
+ public:
+  explicit SoilModel(const SoilConfig& config);
+
+  // Advances one second with the pump on or off
+  void step(bool pumpOn);
+
+  // Volumetric water content and the probe's view of it (0..1 of saturation)
+  float content() const { return storageMm_ / config_.rootDepthMm; }
+  float relativeSaturation() const { return content() / config_.saturation; }
+
+  uint32_t seconds() const { return seconds_; }
+  const SoilTotals& totals() const { return totals_; }
+  const SoilConfig& config() const { return config_; }
+
+  // Deterministic uniform [0, 1), shared with the probe noise
+  float random();
+
+ private:
+  void startDay();
+
+  SoilConfig config_;
+  SoilTotals totals_;
+  uint32_t rng_;
+  uint32_t seconds_;
+  double storageMm_;
+
+  // Today's weather, drawn at midnight
+  float et0Today_;
+  uint32_t rainStart_;
+  uint32_t rainEnd_;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+
+// Fixed-capacity storage that lives in .bss, so steady-state operation never
+// touches the heap. Neither type is thread safe; each instance belongs to one
+// task (cross-task messages go through statically allocated queues).
+
+// Free-list pool of N objects of type T
+template <typename T, size_t N>
+class ObjectPool {
+ public:
+  ObjectPool() : free_(nullptr), inUse_(0), highWater_(0), failures_(0) {
+    for (size_t i = 0; i < N; i++) {
+      slots_[i].next = free_;
+      free_ = &slots_[i];
+    }
+  }
+
+  // Returns nullptr when exhausted
+  template <typename... Args>
+  T* create(Args&&... args) {
+    Slot* slot = free_;
+    if (!slot) {
+      failures_++;
+      return nullptr;
+    }
+    free_ = slot->next;
+    if (++inUse_ > highWater_) highWater_ = inUse_;
+    return new (slot->storage) T(std::forward<Args>(args)...);
+  }
+
+  void destroy(T* object) {
+    if (!object) return;
+    object->~T();
+    Slot* slot = reinterpret_cast<Slot*>(object);
+    slot->next = free_;
+    free_ = slot;
+    inUse_--;
+  }
+
+  size_t capacity() const { return N; }
+  size_t inUse() const { return inUse_; }
+  size_t highWater() const { return highWater_; }
+  uint32_t failures() const { return failures_; }
+
+ private:
+  union Slot {
+    Slot* next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  Slot slots_[N];
+  Slot* free_;
+  size_t inUse_;
+  size_t highWater_;
+  uint32_t failures_;
+};
+
+// Bump allocator released all at once, e.g. per HTTP request
+template <size_t N>
+class Arena {
+ public:
+  Arena() : used_(0), highWater_(0), failures_(0) {}
+
+  // Returns nullptr when the arena can't fit the request
+  void* allocate(size_t size, size_t align = alignof(max_align_t)) {
+    size_t start = (used_ + align - 1) & ~(align - 1);
+    if (start + size > N) {
+      failures_++;
+      return nullptr;
+    }
+    used_ = start + size;
+    if (used_ > highWater_) highWater_ = used_;
+    return buffer_ + start;
+  }
+
+  // Hand out everything that is left (at least `minimum` bytes)
+  char* allocateRest(size_t& size, size_t minimum = 1) {
+    size = N - used_;
+    if (size < minimum) {
+      failures_++;
+      size = 0;
+      return nullptr;
+    }
+    char* rest = reinterpret_cast<char*>(buffer_ + used_);
+    used_ = N;
+    highWater_ = N;
+    return rest;
+  }
+
+  void reset() { used_ = 0; }
+
+  size_t capacity() const { return N; }
+  size_t used() const { return used_; }
+  size_t highWater() const { return highWater_; }
+  uint32_t failures() const { return failures_; }
+
+ private:
+  alignas(max_align_t) uint8_t buffer_[N];
+  size_t used_;
+  size_t highWater_;
+  uint32_t failures_;
+};
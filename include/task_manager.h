@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ESP32)
+#include <Arduino.h>
+#endif
+
+#include "text_buffer.h"
+
+// FreeRTOS task partitioning.
+//
+// Networking owns core 0 (next to the WiFi stack), sampling/control and the
+// LCD/menu UI share core 1 with control at the higher priority so a busy web
+// client or a slow I2C transfer can never delay a relay decision. The Linux
+// build runs the same task bodies from one thread and only keeps the stats.
+enum TaskId {
+  TASK_NETWORK = 0,
+  TASK_CONTROL,
+  TASK_UI,
+  TASK_COUNT
+};
+
+struct TaskStats {
+  const char* name;
+  uint8_t core;
+  uint8_t priority;
+  uint32_t stackBytes;       // statically allocated stack size
+  uint32_t stackFreeBytes;   // high-water mark, refreshed by taskStatsJson()
+  uint16_t cpuPermille;      // busy time over the last completed window
+  uint32_t maxBusyUs;        // longest single busy section since boot
+};
+
+#if defined(ESP32)
+// Create and pin one task on its static stack from the task table.
+bool startTask(TaskId id, TaskFunction_t fn);
+TaskHandle_t taskHandle(TaskId id);
+#endif
+
+// Bracket the work done by a task each iteration; time spent blocked in
+// vTaskDelay()/queues between the two calls is not counted as CPU usage.
+// Each bracket is also recorded in the task's iteration latency histogram.
+void taskBusyBegin(TaskId id);
+void taskBusyEnd(TaskId id);
+
+// Control period jitter: actual tick spacing minus the nominal interval.
+void recordControlTick(uint32_t nominalUs);
+
+// Stack bytes the task has never touched; false where that isn't measured
+// (Linux builds, or before the task started)
+bool taskStackFree(TaskId id, uint32_t& bytes);
+
+const TaskStats& taskStats(TaskId id);
+void taskStatsJson(TextBuffer& out);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "moisture_sample.h"
+#include "text_buffer.h"
+
+// Batched MQTT telemetry for the fleet broker.
+//
+// The network task records every sample; only changes against the
+// previous one are kept (percent, relay, buzzer, mode, threshold), and once
+// per interval they go out as one message on <prefix>/telemetry:
+//
+//   {"seq":7,"from":60000,"to":119000,"samples":60,"min":41,"max":43,"avg":42,
+//    "deltas":[{"t":0,"p":42,"r":0,"b":0,"m":1,"th":40},{"t":17,"p":41,"r":1}]}
+//
+// The first delta of every batch is a full snapshot so each message stands
+// alone; "t" is seconds into the batch. At QoS 1 one message is in flight
+// at a time. Batches that can't go out (no broker, or unacknowledged when
+// the link dropped) wait in a 16-slot queue in flash, oldest dropped when
+// full, and are sent first once the broker is back.
+//
+// <prefix>/status is "online" (retained) while connected, with "offline" as
+// the will. <prefix>/cmd takes {"threshold":45} and {"mode":"wifi"} or
+// {"mode":"manual"}.
+struct TelemetryConfig {
+  const char* host;          // nullptr leaves telemetry off
+  uint16_t port;
+  const char* clientId;
+  const char* topicPrefix;
+  uint32_t intervalMs;
+  uint8_t qos;               // 0 or 1
+};
+
+static const int telemetryQueueSlots = 16;
+
+// After halStorageBegin()
+void telemetryBegin(const TelemetryConfig& config);
+
+// Network task
+void telemetryRecord(const MoistureSample& sample, int threshold);
+void telemetryPoll(uint32_t nowMs);
+
+// Connection, reconnect times, queue depth and publish throughput
+void telemetryJson(TextBuffer& out);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+
+// Append-only, NUL-terminated text in caller-provided storage. Used instead
+// of String to build HTTP responses without heap allocation. Output that
+// doesn't fit is truncated and flagged.
+class TextBuffer {
+ public:
+  TextBuffer(char* data, size_t capacity);
+
+  TextBuffer& append(const char* text);
+  TextBuffer& appendf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  TextBuffer& vappendf(const char* format, va_list args);
+
+  void clear();
+
+  const char* c_str() const { return data_; }
+  size_t length() const { return length_; }
+  size_t capacity() const { return capacity_; }
+  bool overflowed() const { return overflowed_; }
+
+ private:
+  char* data_;
+  size_t capacity_;
+  size_t length_;
+  bool overflowed_;
+};
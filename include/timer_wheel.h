@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef void (*TimerCallback)(void* arg);
+
+// Intrusive timer; the owner provides the storage, the wheel never allocates
+struct WheelTimer {
+  WheelTimer(const char* name, TimerCallback callback, void* arg = nullptr)
+      : name(name), callback(callback), arg(arg) {}
+
+  const char* name;
+  TimerCallback callback;   // may be null for pure timeouts polled via `active`
+  void* arg;
+
+  uint32_t expires = 0;   // absolute tick
+  uint32_t period = 0;    // 0 for one-shot
+  bool active = false;
+
+  // Lateness of this timer's callbacks, in ticks
+  uint32_t fired = 0;
+  uint32_t maxLate = 0;
+
+  // Position in the wheel while active
+  uint8_t level = 0;
+  uint8_t slot = 0;
+  WheelTimer* next = nullptr;
+  WheelTimer* prev = nullptr;
+  WheelTimer* registryNext = nullptr;
+  bool registered = false;
+};
+
+struct TimerWheelStats {
+  uint32_t fired;
+  uint32_t late;        // callbacks that ran one or more ticks after expiry
+  uint32_t maxLate;     // ticks
+  uint32_t totalLate;   // ticks, for the mean
+};
+
+// Hierarchical timer wheel: 4 levels of 64 slots at 1 tick granularity
+// cover 2^24 ticks (4.6 hours at 1 ms) and longer delays are re-cascaded.
+// Start and stop are O(1); advance() does O(1) work per elapsed tick and
+// skips runs of empty ticks using per-level occupancy bitmaps.
+//
+// Not thread safe: each task owns its own wheel.
+class TimerWheel {
+ public:
+  static const int levels = 4;
+  static const int slotBits = 6;
+  static const int slots = 1 << slotBits;
+
+  explicit TimerWheel(uint32_t now = 0);
+
+  // Fire after `delay` ticks, then every `period` ticks if non-zero.
+  // Restarting an active timer reschedules it.
+  void start(WheelTimer& timer, uint32_t delay, uint32_t period = 0);
+  void stop(WheelTimer& timer);
+
+  // Run every timer due at or before `now`
+  void advance(uint32_t now);
+
+  // Ticks from `now` until the earliest pending expiry, 0 if one is already
+  // due, or `limit` if nothing expires sooner.
+  uint32_t ticksUntilNext(uint32_t now, uint32_t limit) const;
+
+  const TimerWheelStats& stats() const { return stats_; }
+  WheelTimer* timers() const { return registry_; }
+
+ private:
+  void insert(WheelTimer& timer);
+  void unlink(WheelTimer& timer);
+  void fire(int slot, uint32_t now);
+  void cascade(int level, int slot);
+
+  uint32_t now_;  // last processed tick
+  WheelTimer* wheel_[levels][slots];
+  uint64_t occupied_[levels];
+  WheelTimer* registry_;
+  TimerWheelStats stats_;
+};
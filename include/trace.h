@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "cycle_counter.h"
+#include "task_manager.h"
+#include "text_buffer.h"
+
+// Firmware timeline: begin/end spans and instants on a few tracks, kept in
+// a 512-event TraceRing and exported as Chrome trace JSON (loads in
+// Perfetto and chrome://tracing).
+//
+// Timestamps are per-core cycle counts. Each core records a clock-sync
+// event about once a second (from taskBusyBegin()), and the export converts
+// cycles to microseconds from the latest sync on the same core. Events
+// older than a core's first retained sync are dropped from the export.
+enum TraceTrack : uint8_t {
+  TRACK_NETWORK = TASK_NETWORK,
+  TRACK_CONTROL = TASK_CONTROL,
+  TRACK_UI = TASK_UI,
+  TRACK_ISR,
+  TRACK_COUNT
+};
+
+void traceBegin(TraceTrack track, const char* name);
+void traceEnd(TraceTrack track, const char* name);
+void traceInstant(TraceTrack track, const char* name);
+
+// Records a clock-sync event for the calling core if the last one is more
+// than a second old
+void traceClockSync();
+
+// Span covering the enclosing scope
+class TraceScope {
+ public:
+  TraceScope(TraceTrack track, const char* name) : track_(track), name_(name) {
+    traceBegin(track, name);
+  }
+  ~TraceScope() { traceEnd(track_, name_); }
+
+ private:
+  TraceTrack track_;
+  const char* name_;
+};
+
+typedef void (*TraceFlush)(TextBuffer& chunk);
+
+// Appends the retained events as a Chrome trace JSON document, calling
+// `flush` whenever `chunk` is close to full
+void traceChromeJson(TextBuffer& chunk, TraceFlush flush);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// One timeline event. `name` must point at storage that outlives the trace
+// (string literals, route paths).
+struct TraceEvent {
+  uint32_t cycles;    // CCOUNT of the recording core
+  const char* name;
+  uint32_t arg;       // clock-sync events: esp_timer microseconds
+  char phase;         // 'B' begin, 'E' end, 'i' instant, 'S' clock sync
+  uint8_t core;
+  uint8_t track;
+};
+
+// Lock-free multi-producer trace ring. Producers on either core and in ISRs
+// claim a slot with one atomic increment and never wait; the oldest events
+// are overwritten. Each slot carries the sequence number of the event it
+// holds, so a reader can tell an intact copy from one overwritten or still
+// being written, and skips it.
+template <size_t Capacity>
+class TraceRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "TraceRing capacity must be a power of two");
+
+ public:
+  TraceRing() : head_(0) {
+    for (size_t i = 0; i < Capacity; i++) {
+      slots_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void record(const TraceEvent& event) {
+    uint32_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index & mask];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(index + 1, std::memory_order_release);
+  }
+
+  // Events ever recorded; indices [head() - Capacity, head()) may be live
+  uint32_t head() const { return head_.load(std::memory_order_acquire); }
+
+  bool read(uint32_t index, TraceEvent& out) const {
+    const Slot& slot = slots_[index & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+      return false;
+    }
+    out = slot.event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+  }
+
+  size_t capacity() const { return Capacity; }
+
+ private:
+  static const uint32_t mask = Capacity - 1;
+
+  struct Slot {
+    std::atomic<uint32_t> sequence;   // index + 1 of the event held, 0 while written
+    TraceEvent event;
+  };
+
+  std::atomic<uint32_t> head_;
+  Slot slots_[Capacity];
+};
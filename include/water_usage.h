@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "seqlock.h"
+
+// Irrigation zones, one per relay
+static const int waterZoneCount = 1;
+
+struct ZoneUsage {
+  uint32_t totalMl;    // since first boot, persisted
+  uint32_t todayMl;
+  uint32_t sessions;   // completed since boot
+};
+
+struct WaterUsageSnapshot {
+  uint32_t flowMlPerMin;     // over the last update
+  int8_t sessionZone;        // zone of the running session, -1 when idle
+  uint32_t sessionMl;        // running session, or the last one when idle
+  uint32_t sessionSeconds;
+  uint32_t sessions;         // completed since boot, all zones
+  uint32_t day;              // uptime days; there is no wall clock in AP mode
+  uint32_t todayMl;          // all zones
+  uint32_t yesterdayMl;
+  uint32_t unattributedMl;   // flow with no zone open: leaks or a stuck valve
+  ZoneUsage zones[waterZoneCount];
+};
+
+// Turns flow meter pulses into per-session, per-day and per-zone totals.
+//
+// A session runs while a zone's relay is on, plus a short tail after it
+// closes so water still draining through the meter is billed to that zone.
+// The control task updates it; other tasks read the published snapshot.
+class WaterUsage {
+ public:
+  static const uint32_t sessionTailSeconds = 5;
+
+  WaterUsage();
+
+  // `zoneTotalsMl` restored from NVS, waterZoneCount entries
+  void begin(uint32_t pulsesPerLiter, const uint32_t* zoneTotalsMl);
+
+  // Control task only. `pulses` were counted over the `elapsedMs` before
+  // `nowSeconds` (uptime) while `zone` was open, -1 if none.
+  void update(uint32_t pulses, uint32_t elapsedMs, int zone, uint32_t nowSeconds);
+
+  WaterUsageSnapshot snapshot() const { return published_.read(); }
+
+ private:
+  void closeSession();
+
+  WaterUsageSnapshot state_;
+  Seqlock<WaterUsageSnapshot> published_;
+  uint32_t pulsesPerLiter_;
+  uint32_t remainder_;       // pulses * 1000 not yet converted to whole ml
+  uint32_t closedAt_;        // uptime seconds the session's relay went off
+  bool closing_;
+};
@@ -0,0 +1,49 @@
+#include "ap_lifecycle.h"
+
+ApLifecycle::ApLifecycle()
+    : requested_(false), on_(false), onSinceMs_(0), lastActivityMs_(0), lastRequestMs_(0),
+      stations_(0), starts_(0), radioOnMs_(0) {}
+
+ApAction ApLifecycle::poll(uint32_t nowMs, int stations, uint32_t lastRequestMs) {
+  bool requested = requested_;
+  requested_ = false;
+  if (!on_) {
+    return requested ? AP_START : AP_NONE;
+  }
+
+  // Anything that shows someone is (or was just) around restarts the clock
+  if (requested || stations != stations_ || lastRequestMs != lastRequestMs_) {
+    lastActivityMs_ = nowMs;
+  }
+  stations_ = stations;
+  lastRequestMs_ = lastRequestMs;
+
+  uint32_t timeout = stations ? idleTimeoutMs : emptyTimeoutMs;
+  return nowMs - lastActivityMs_ >= timeout ? AP_STOP : AP_NONE;
+}
+
+void ApLifecycle::started(uint32_t nowMs) {
+  on_ = true;
+  onSinceMs_ = nowMs;
+  lastActivityMs_ = nowMs;
+  stations_ = 0;
+  starts_++;
+}
+
+void ApLifecycle::stopped(uint32_t nowMs) {
+  on_ = false;
+  radioOnMs_ += nowMs - onSinceMs_;
+}
+
+uint64_t ApLifecycle::radioOnMs(uint32_t nowMs) const {
+  return radioOnMs_ + (on_ ? nowMs - onSinceMs_ : 0);
+}
+
+void ApLifecycle::json(TextBuffer& out, uint32_t nowMs) const {
+  out.appendf("{\"on\":%s,\"stations\":%d,\"idleMs\":%u,\"timeoutMs\":%u,\"starts\":%u,"
+              "\"radioOnMs\":%llu,\"radioOnPermille\":%u}",
+              on_ ? "true" : "false", stations_, on_ ? (unsigned)(nowMs - lastActivityMs_) : 0,
+              (unsigned)(stations_ ? idleTimeoutMs : emptyTimeoutMs), (unsigned)starts_,
+              (unsigned long long)radioOnMs(nowMs),
+              nowMs ? (unsigned)(radioOnMs(nowMs) * 1000 / nowMs) : 0);
+}
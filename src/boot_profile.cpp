@@ -0,0 +1,84 @@
+#include "boot_profile.h"
+
+#include "hal.h"
+
+static const char* phaseNames[BOOT_PHASE_COUNT] = {
+  "setup", "safe-outputs", "storage", "drivers", "control-started",
+  "first-sample", "first-decision", "display", "network", "http",
+};
+
+// halMicros() + 1, so 0 marks a phase not reached yet (the native virtual
+// clock starts at 0)
+static uint32_t stamps[BOOT_PHASE_COUNT];
+static uint32_t reached = 0;
+static bool reported = false;   // network task only
+
+static void printBootLog() {
+  // Chronological; on the fast path the background phases interleave
+  uint8_t order[BOOT_PHASE_COUNT];
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    int j = i;
+    for (; j > 0 && stamps[order[j - 1]] > stamps[i]; j--) {
+      order[j] = order[j - 1];
+    }
+    order[j] = (uint8_t)i;
+  }
+
+  halPrintf("Boot (%s path):\n", bootFastPath() ? "fast" : "serial");
+  uint32_t previous = stamps[order[0]];
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    uint32_t at = stamps[order[i]] - 1;
+    halPrintf("  %-16s %6u.%u ms  (+%u.%u)\n", phaseNames[order[i]], (unsigned)(at / 1000),
+              (unsigned)(at / 100 % 10), (unsigned)((stamps[order[i]] - previous) / 1000),
+              (unsigned)((stamps[order[i]] - previous) / 100 % 10));
+    previous = stamps[order[i]];
+  }
+  uint32_t decision = stamps[BOOT_FIRST_DECISION] - stamps[BOOT_SETUP];
+  halPrintf("Time to first control decision: %u.%u ms after setup()\n",
+            (unsigned)(decision / 1000), (unsigned)(decision / 100 % 10));
+}
+
+void bootMark(BootPhase phase) {
+  uint32_t expected = 0;
+  uint32_t stamp = (uint32_t)halMicros() + 1;
+  if (!__atomic_compare_exchange_n(&stamps[phase], &expected, stamp, false, __ATOMIC_RELEASE,
+                                   __ATOMIC_RELAXED)) {
+    return;
+  }
+  __atomic_add_fetch(&reached, 1, __ATOMIC_ACQ_REL);
+}
+
+void bootReportPoll() {
+  if (reported || __atomic_load_n(&reached, __ATOMIC_ACQUIRE) != BOOT_PHASE_COUNT) {
+    return;
+  }
+  reported = true;
+  printBootLog();
+}
+
+bool bootPhaseTime(BootPhase phase, uint32_t& us) {
+  uint32_t stamp = __atomic_load_n(&stamps[phase], __ATOMIC_ACQUIRE);
+  us = stamp - 1;
+  return stamp != 0;
+}
+
+bool bootFastPath() {
+#if defined(FAST_BOOT)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void bootProfileJson(TextBuffer& out) {
+  out.appendf("{\"fastBoot\":%s,\"complete\":%s,\"phases\":{", bootFastPath() ? "true" : "false",
+              __atomic_load_n(&reached, __ATOMIC_ACQUIRE) == BOOT_PHASE_COUNT ? "true" : "false");
+  int n = 0;
+  for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    uint32_t us;
+    if (bootPhaseTime((BootPhase)i, us)) {
+      out.appendf("%s\"%s\":%u", n++ ? "," : "", phaseNames[i], (unsigned)us);
+    }
+  }
+  out.append("}}");
+}
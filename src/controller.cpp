@@ -0,0 +1,1124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "controller.h"
+#include "boot_profile.h"
+#include "hal.h"
+#include "gpio.h"
+#include "power.h"
+#include "task_manager.h"
+#include "moisture_sample.h"
+#include "timer_wheel.h"
+#include "static_pool.h"
+#include "text_buffer.h"
+#include "heap_guard.h"
+#include "heap_monitor.h"
+#include "field_mode.h"
+#include "moisture_history.h"
+#include "moisture_rollup.h"
+#include "flow_meter.h"
+#include "water_usage.h"
+#include "moisture_probe.h"
+#include "latency_histogram.h"
+#include "route_trace.h"
+#include "telemetry.h"
+#include "trace.h"
+
+
+#define RW_MODE false
+#define RO_MODE true 
+
+const char* thresh = "threshold";
+
+//define functions
+void handleMenu();
+void pollButtons(void* arg);
+void repeatThresholdStep(void* arg);
+void refreshDisplay(void* arg);
+void commitThreshold(void* arg);
+void commitWaterUsage(void* arg);
+void reportLatency(void* arg);
+void sampleHeap(void* arg);
+void timerWheelJson(TextBuffer& out, const TimerWheel& wheel);
+TextBuffer beginResponse();
+void route(const char* path, HalHttpHandler handler);
+bool queryInt(const char* name, long& value);
+void sendText(const char* type, const char* text);
+void sendBody(const TextBuffer& body, const char* type);
+void sendJson(const TextBuffer& body);
+void appendLiters(TextBuffer& out, uint32_t ml);
+TextBuffer beginChunked();
+void flushChunk(TextBuffer& chunk, bool force);
+void streamHistory(uint32_t from);
+void streamRollup(const RollupRing& ring, uint32_t from);
+
+
+// Global Variables
+// Threshold, mode and the latest decision live in `controller`; everything
+// else is owned by a single task
+ControllerState controller;
+uint32_t currentMoisture = 0; // control task, probe units
+bool relayOn = false;         // control task
+bool buzzerOn = false;        // control task
+bool menuActive = false;      // UI task, mirrored to the controller
+bool diagnosticsActive = false; // UI task, LCD shows heap/stack health
+
+// Button State Tracking
+bool lastMenuButtonState = true;  // released, buttons pull up
+bool lastPlusButtonState = true;
+bool lastMinusButtonState = true;
+int heldThresholdStep = 0;  // +1/-1 while plus/minus is held in the menu
+
+
+// Timing Variables (ms)
+const unsigned long debounceDelay = 50;
+const unsigned long moistureCheckInterval = 1000;
+const unsigned long thresholdAdjustInterval = 200;
+const unsigned long buttonPollInterval = 20;
+const unsigned long displayRefreshInterval = 500;
+const unsigned long prefCommitDelay = 2000;
+const unsigned long flashMessageDuration = 1500;
+const unsigned long splashDuration = 2000;
+const unsigned long backlightTimeout = 60000;
+const unsigned long usageCommitInterval = 600000;
+const unsigned long latencyReportInterval = 60000;
+const unsigned long heapSampleInterval = 60000;
+
+// Sensor warm-up: readings settle after a few bursts once powered
+const int adcBurstSize = 8;
+const int warmUpBursts = 3;
+
+// Moisture probe driver, chosen at build time (see moisture_probe.h). The
+// frequency probe uses PCNT unit 1, unit 0 is the flow meter.
+#ifdef MOISTURE_PROBE_FREQUENCY
+MoistureProbe probe(Board::moisturePin, PCNT_UNIT_1);
+#else
+MoistureProbe probe(Board::moisturePin, adcBurstSize);
+#endif
+ProbeCalibration probeCalibration = MoistureProbe::defaultCalibration;
+
+// Each task owns its wheel; only the stats are read from other tasks
+TimerWheel controlTimers;
+WheelTimer sampleTimer("sample", sampleMoisture);
+
+TimerWheel uiTimers;
+WheelTimer buttonTimer("buttons", pollButtons);
+WheelTimer debounceTimer("debounce", nullptr);
+WheelTimer thresholdRepeatTimer("threshold-repeat", repeatThresholdStep);
+WheelTimer displayTimer("display", refreshDisplay);
+WheelTimer prefCommitTimer("pref-commit", commitThreshold);
+WheelTimer usageCommitTimer("usage-commit", commitWaterUsage);
+WheelTimer latencyReportTimer("latency-report", reportLatency);
+WheelTimer heapSampleTimer("heap-monitor", sampleHeap);
+
+// Heap and stack trend, sampled by the UI task
+HeapMonitor heapMonitor;
+
+// Sequential UI logic, resumed by the UI task after its timers
+CoScheduler uiCoroutines(uiTimers);
+
+enum UiEvents {
+  EVENT_ADC_BURST = 1 << 0,    // control task finished a sample burst
+  EVENT_BUTTON_EDGE = 1 << 1,  // falling edge on any button (ISR)
+  EVENT_UI_MESSAGE = 1 << 2,   // uiMessages has an entry
+};
+
+// Transient LCD messages, queued by pollButtons() and shown by
+// MessageOverlay; both run on the UI task
+const int uiMessageSlots = 4;
+const char* uiMessages[uiMessageSlots];
+uint8_t uiMessageHead = 0;
+uint8_t uiMessageCount = 0;
+
+void queueUiMessage(const char* message) {
+  if (uiMessageCount < uiMessageSlots) {
+    uiMessages[(uiMessageHead + uiMessageCount++) % uiMessageSlots] = message;
+  }
+}
+
+bool nextUiMessage(const char*& message) {
+  if (!uiMessageCount) {
+    return false;
+  }
+  message = uiMessages[uiMessageHead];
+  uiMessageHead = (uiMessageHead + 1) % uiMessageSlots;
+  uiMessageCount--;
+  return true;
+}
+
+// Scratch for building one HTTP response, reset by every handler. Only the
+// network task touches it, so steady-state requests never hit the heap.
+Arena<4096> requestArena;
+
+// Per-route request/time/bytes/heap accounting, network task only
+RouteTracer routes;
+uint32_t lastRequestMs = 0;
+
+// Switched by the network task, raised on request by the UI task
+ApLifecycle accessPoint;
+
+// Water metering on PCNT unit 0, polled and accounted by the control task
+FlowMeter flowMeter(Board::flowMeterPin, 0);
+WaterUsage waterUsage;
+uint32_t lastFlowPollMs = 0;
+
+// Zone totals as last written to NVS, UI task only
+uint32_t committedZoneMl[waterZoneCount];
+
+// Acquisition -> control, web and history consumers
+MoistureSampleRing samples;
+
+// Compressed 1 Hz history and its rollups, appended and served by the
+// network task
+MoistureHistory history;
+MoistureRollups rollups;
+
+// LCD overlay text set by the coroutines, UI task only
+const char* flashMessage = nullptr;
+
+// Boot splash, previously a blocking delay() in setup()
+struct SplashScreen : CoFrame {
+  CoStatus resume() override {
+    CO_BEGIN();
+    flashMessage = "Smart Irrigation";
+    updateDisplay();
+    CO_SLEEP(splashDuration);
+    flashMessage = nullptr;
+    updateDisplay();
+    CO_END();
+  }
+};
+
+// Shows each queued message for flashMessageDuration
+struct MessageOverlay : CoFrame {
+  const char* message;
+
+  CoStatus resume() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_AWAIT_UNTIL(nextUiMessage(message), EVENT_UI_MESSAGE);
+      flashMessage = message;
+      updateDisplay();
+      CO_SLEEP(flashMessageDuration);
+      flashMessage = nullptr;
+      updateDisplay();
+    }
+    CO_END();
+  }
+};
+
+// Hold off relay decisions until the probe has produced stable bursts
+struct SensorWarmUp : CoFrame {
+  int bursts = 0;
+
+  CoStatus resume() override {
+    CO_BEGIN();
+    for (bursts = 0; bursts < warmUpBursts; bursts++) {
+      CO_AWAIT_EVENT(EVENT_ADC_BURST);
+    }
+    controller.post(CMD_SET_SENSOR_READY, 1);
+    CO_END();
+  }
+};
+
+// Backlight off after a minute without button activity, on at the next press
+struct BacklightTimeout : CoFrame {
+  CoStatus resume() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_AWAIT_EVENT_FOR(EVENT_BUTTON_EDGE, backlightTimeout);
+      if (timedOut()) {
+        halDisplayBacklight(false);
+        CO_AWAIT_EVENT(EVENT_BUTTON_EDGE);
+        halDisplayBacklight(true);
+      }
+    }
+    CO_END();
+  }
+};
+
+void IRAM_ATTR onButtonEdge() {
+  traceInstant(TRACK_ISR, "button-edge");
+  uiCoroutines.signal(EVENT_BUTTON_EDGE);
+}
+
+// HTML Page
+const char* htmlPage = R"rawliteral(
+<!DOCTYPE html>
+<html>
+<head>
+    <title>Smart Irrigation System</title>
+    <meta name="viewport" content="width=device-width, initial-scale=1">
+    <style>
+        body {
+            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
+            margin: 0;
+            padding: 0;
+            background-color: #f0f4f8;
+            display: flex;
+            justify-content: center;
+            align-items: center;
+            min-height: 100vh;
+        }
+        .container {
+            background-color: white;
+            border-radius: 15px;
+            box-shadow: 0 10px 25px rgba(0,0,0,0.1);
+            padding: 30px;
+            width: 90%;
+            max-width: 500px;
+            text-align: center;
+        }
+        h1 {
+            color: #2c3e50;
+            margin-bottom: 20px;
+        }
+        .status-card {
+            background-color: #ecf0f1;
+            border-radius: 10px;
+            padding: 15px;
+            margin-bottom: 20px;
+        }
+        .status-label {
+            font-weight: bold;
+            color: #34495e;
+        }
+        .threshold-control {
+            display: flex;
+            align-items: center;
+            justify-content: space-between;
+            margin-bottom: 20px;
+        }
+        input[type="range"] {
+            flex-grow: 1;
+            margin: 0 15px;
+        }
+        .btn {
+            background-color: #3498db;
+            color: white;
+            border: none;
+            padding: 10px 20px;
+            border-radius: 5px;
+            cursor: pointer;
+            transition: background-color 0.3s ease;
+        }
+        .btn:hover {
+            background-color: #2980b9;
+        }
+        #modeToggle {
+            background-color: #2ecc71;
+        }
+        #modeToggle:hover {
+            background-color: #27ae60;
+        }
+    </style>
+</head>
+<body>
+    <div class="container">
+        <h1>Smart Irrigation System</h1>
+        <div class="status-card">
+            <p><span class="status-label">Soil Moisture:</span> <span id="moisture">0%</span></p>
+            <p><span class="status-label">System Status:</span> <span id="systemStatus">Idle</span></p>
+        </div>
+        <div class="threshold-control">
+            <span>Moisture Threshold:</span>
+            <span id="threshold">40</span>%
+            <input type="range" id="thresholdSlider" min="0" max="100" value="40" onchange="updateThreshold(this.value)">
+        </div>
+        <div>
+            <button class="btn" onclick="changeThreshold('decrease')">-</button>
+            <button class="btn" onclick="changeThreshold('increase')">+</button>
+            <button id="modeToggle" class="btn" onclick="toggleMode()">Toggle Mode</button>
+        </div>
+    </div>
+
+    <script>
+        async function updatePage() {
+            const response = await fetch('/status');
+            const data = await response.json();
+            document.getElementById('moisture').textContent = data.moisture + '%';
+            document.getElementById('threshold').textContent = data.threshold + '%';
+            document.getElementById('thresholdSlider').value = data.threshold;
+            document.getElementById('systemStatus').textContent = data.status;
+        }
+
+        async function changeThreshold(action) {
+            await fetch('/threshold?action=' + action);
+            updatePage();
+        }
+
+        async function updateThreshold(value) {
+            await fetch('/threshold?value=' + value);
+            updatePage();
+        }
+
+        async function toggleMode() {
+            await fetch('/toggle-mode');
+            updatePage();
+        }
+
+        setInterval(updatePage, 2000);
+        updatePage();
+    </script>
+</body>
+</html>
+)rawliteral";
+
+void controllerBegin(const ControllerResume* resume) {
+  controllerBeginControl(resume);
+  controllerBeginDisplay();
+}
+
+void controllerBeginControl(const ControllerResume* resume) {
+  // Relay and buzzer off before anything else, unless the relay is already
+  // driven from a field-mode cycle
+  if (resume) {
+    relayOn = resume->relayOn;
+  } else {
+    RelayOutput::begin(false);
+  }
+  BuzzerOutput::begin(false);
+  MenuButtonInput::begin(true);
+  PlusButtonInput::begin(true);
+  MinusButtonInput::begin(true);
+  bootMark(BOOT_SAFE_OUTPUTS);
+  powerBegin();
+  powerHold(POWER_HOLD_PUMP, relayOn);
+
+  // init pref
+
+  halStorageBegin("pref");
+  controller.begin(resume ? resume->threshold : halStorageGetInt(thresh, 40), false);
+
+  for (int z = 0; z < waterZoneCount; z++) {
+    char key[16];
+    snprintf(key, sizeof(key), "zone%dMl", z);
+    committedZoneMl[z] = halStorageGetUInt(key, 0);
+  }
+  waterUsage.begin(FLOW_PULSES_PER_LITER, committedZoneMl);
+  bootMark(BOOT_STORAGE);
+
+  if (!probe.begin()) {
+    halPrintf("Moisture probe init failed\n");
+  }
+#ifdef MOISTURE_PROBE_FREQUENCY
+  else {
+    // PCNT doesn't count in light sleep; see power.h
+    powerHold(POWER_HOLD_PROBE, true);
+  }
+#endif
+  if (!flowMeter.begin()) {
+    halPrintf("Flow meter init failed\n");
+  }
+  bootMark(BOOT_DRIVERS);
+
+  // The splash is shown by the SplashScreen coroutine once the UI task runs
+  uiCoroutines.spawn<SplashScreen>();
+  uiCoroutines.spawn<MessageOverlay>();
+  uiCoroutines.spawn<SensorWarmUp>();
+  uiCoroutines.spawn<BacklightTimeout>();
+
+  halAttachFallingEdge(MenuButtonInput::pin, onButtonEdge);
+  halAttachFallingEdge(PlusButtonInput::pin, onButtonEdge);
+  halAttachFallingEdge(MinusButtonInput::pin, onButtonEdge);
+}
+
+void controllerBeginDisplay() {
+  halDisplayBegin();
+  bootMark(BOOT_DISPLAY);
+}
+
+
+void setupServer (){
+  halHttpBegin(80);
+
+  // Web Server Routes
+  route("/", []() {
+    sendText("text/html", htmlPage);
+  });
+
+  route("/status", []() {
+    // In WiFi mode the relay follows the threshold when the dashboard polls
+    controller.post(CMD_STATUS_POLLED);
+    TextBuffer json = beginResponse();
+    statusJson(json);
+    sendJson(json);
+  });
+
+  route("/threshold", []() {
+    char action[16];
+    long value;
+    if (halHttpArg("action", action, sizeof(action))) {
+      if (strcmp(action, "increase") == 0) {
+        controller.post(CMD_ADJUST_THRESHOLD, 1);
+
+      } else if (strcmp(action, "decrease") == 0) {
+        controller.post(CMD_ADJUST_THRESHOLD, -1);
+      }
+    } else if (queryInt("value", value)) {
+      controller.post(CMD_SET_THRESHOLD, value < 0 ? 0 : value > 100 ? 100 : value);
+
+    }
+    sendText("text/plain", "Threshold updated");
+  });
+
+  route("/toggle-mode", []() {
+    // The UI task shows the new mode, the handler no longer blocks on it
+    controller.post(CMD_TOGGLE_MODE);
+    sendText("text/plain", "Mode toggled");
+  });
+
+  route("/tasks", []() {
+    TextBuffer json = beginResponse();
+    taskStatsJson(json);
+    sendJson(json);
+  });
+
+  route("/timers", []() {
+    TextBuffer json = beginResponse();
+    json.append("{\"control\":");
+    timerWheelJson(json, controlTimers);
+    json.append(",\"ui\":");
+    timerWheelJson(json, uiTimers);
+    json.append("}");
+    sendJson(json);
+  });
+
+  // Samples published since the previous call, for dashboards that chart
+  // the raw stream rather than polling /status
+  route("/samples", []() {
+    static const char* readerNames[SAMPLE_READER_COUNT] = { "control", "web", "history" };
+    TextBuffer json = beginResponse();
+    json.appendf("{\"published\":%u,\"readers\":[", (unsigned)samples.published());
+    for (int i = 0; i < SAMPLE_READER_COUNT; i++) {
+      json.appendf("%s{\"name\":\"%s\",\"pending\":%u,\"overruns\":%u}", i ? "," : "",
+                   readerNames[i], (unsigned)samples.available(i), (unsigned)samples.overruns(i));
+    }
+    json.append("],\"samples\":[");
+    MoistureSample sample;
+    for (int n = 0; samples.pop(READER_WEB, sample); n++) {
+      json.appendf("%s[%u,%u,%u,%u]", n ? "," : "", (unsigned)sample.timeMs, (unsigned)sample.raw,
+                   sample.percent, sample.flags);
+    }
+    json.appendf("],\"droppedCommands\":%u}", (unsigned)controller.droppedCommands());
+    sendJson(json);
+  });
+
+  // The last `seconds` (default one hour) in at most `points` entries
+  // (default 360): raw 1 Hz points when they fit, otherwise the finest
+  // rollup that does. Streamed in chunks.
+  route("/history", []() {
+    long seconds = 3600;
+    long points = 360;
+    queryInt("seconds", seconds);
+    queryInt("points", points);
+    uint32_t span = seconds;
+    uint32_t maxPoints = points < 10 ? 10 : points > 2000 ? 2000 : points;
+    uint32_t newest = history.newestTime();
+    uint32_t from = span < newest ? newest - span : 0;
+
+    if (span <= maxPoints && history.oldestTime() <= from) {
+      streamHistory(from);
+    } else {
+      streamRollup(rollups.select(from, newest, maxPoints), from);
+    }
+  });
+
+  // Prometheus text exposition for scraping
+  route("/metrics", []() {
+    ControllerSnapshot snap = controller.snapshot();
+    WaterUsageSnapshot usage = waterUsage.snapshot();
+
+    TextBuffer text = beginResponse();
+    text.appendf("# TYPE irrigation_moisture_percent gauge\n"
+                 "irrigation_moisture_percent %u\n"
+                 "# TYPE irrigation_threshold_percent gauge\n"
+                 "irrigation_threshold_percent %d\n"
+                 "# TYPE irrigation_relay_on gauge\n"
+                 "irrigation_relay_on %d\n",
+                 snap.percent, controller.threshold(), snap.relayOn ? 1 : 0);
+    text.append("# TYPE irrigation_flow_liters_per_minute gauge\nirrigation_flow_liters_per_minute ");
+    appendLiters(text, usage.flowMlPerMin);
+    text.append("\n# TYPE irrigation_session_liters gauge\nirrigation_session_liters ");
+    appendLiters(text, usage.sessionMl);
+    text.append("\n# TYPE irrigation_unattributed_liters_total counter\nirrigation_unattributed_liters_total ");
+    appendLiters(text, usage.unattributedMl);
+    text.append("\n# TYPE irrigation_water_liters_total counter\n");
+    for (int z = 0; z < waterZoneCount; z++) {
+      text.appendf("irrigation_water_liters_total{zone=\"%d\"} ", z);
+      appendLiters(text, usage.zones[z].totalMl);
+      text.append("\n");
+    }
+    text.append("# TYPE irrigation_water_today_liters gauge\n");
+    for (int z = 0; z < waterZoneCount; z++) {
+      text.appendf("irrigation_water_today_liters{zone=\"%d\"} ", z);
+      appendLiters(text, usage.zones[z].todayMl);
+      text.append("\n");
+    }
+    text.append("# TYPE irrigation_sessions_total counter\n");
+    for (int z = 0; z < waterZoneCount; z++) {
+      text.appendf("irrigation_sessions_total{zone=\"%d\"} %u\n", z, (unsigned)usage.zones[z].sessions);
+    }
+    sendBody(text, "text/plain; version=0.0.4");
+  });
+
+  // Cycle-counter latency per task iteration and section; ?reset=1 starts
+  // a new measurement window
+  route("/latency", []() {
+    char reset[8];
+    if (halHttpArg("reset", reset, sizeof(reset))) {
+      latencyReset();
+    }
+    TextBuffer json = beginResponse();
+    latencyJson(json);
+    sendJson(json);
+  });
+
+  route("/debug/routes", []() {
+    TextBuffer json = beginResponse();
+    routes.json(json);
+    sendJson(json);
+  });
+
+  // Timeline of the last ~512 events as Chrome trace JSON, open it in
+  // ui.perfetto.dev or chrome://tracing
+  route("/debug/trace", []() {
+    TextBuffer chunk = beginChunked();
+    traceChromeJson(chunk, [](TextBuffer& c) { flushChunk(c, false); });
+    flushChunk(chunk, true);
+  });
+
+  route("/debug/heap", []() {
+    TextBuffer json = beginResponse();
+    heapMonitor.json(json);
+    sendJson(json);
+  });
+
+  route("/debug/boot", []() {
+    TextBuffer json = beginResponse();
+    bootProfileJson(json);
+    sendJson(json);
+  });
+
+  route("/debug/power", []() {
+    TextBuffer json = beginResponse();
+    powerStatsJson(json);
+    sendJson(json);
+  });
+
+  route("/debug/field", []() {
+    TextBuffer json = beginResponse();
+    fieldJson(json);
+    sendJson(json);
+  });
+
+  route("/debug/ap", []() {
+    TextBuffer json = beginResponse();
+    accessPoint.json(json, halMillis());
+    sendJson(json);
+  });
+
+  route("/debug/mqtt", []() {
+    TextBuffer json = beginResponse();
+    telemetryJson(json);
+    sendJson(json);
+  });
+
+  route("/heap", []() {
+    TextBuffer json = beginResponse();
+    heapGuardJson(json);
+    sendJson(json);
+  });
+
+  bootMark(BOOT_HTTP);
+}
+
+// Network task body: feeds the history and telemetry, then serves whatever
+// is pending
+void networkPoll() {
+  taskBusyBegin(TASK_NETWORK);
+  MoistureSample sample;
+  while (samples.pop(READER_HISTORY, sample)) {
+    rollups.append(history.append(sample), sample);
+    telemetryRecord(sample, controller.threshold());
+  }
+  telemetryPoll(halMillis());
+  bootReportPoll();
+  {
+    LatencyScope scope(latency(LAT_HANDLE_CLIENT));
+    halHttpPoll();
+  }
+  taskBusyEnd(TASK_NETWORK);
+}
+
+// The first sample runs on the next tick so the relay state is decided (and
+// published) as soon as the control task is up
+void controlBegin() {
+  controlTimers.advance(halMillis());
+  controlTimers.start(sampleTimer, 0, moistureCheckInterval);
+  bootMark(BOOT_CONTROL_STARTED);
+}
+
+// Due timers always run before further commands
+uint32_t controlPoll() {
+  powerTaskRunning(TASK_CONTROL);
+  controlTimers.advance(halMillis());
+  while (controller.applyNext()) {
+  }
+  uint32_t wait = controlTimers.ticksUntilNext(halMillis(), moistureCheckInterval);
+  powerTaskBlocking(TASK_CONTROL, wait);
+  return wait;
+}
+
+void sampleMoisture(void* arg) {
+  recordControlTick(moistureCheckInterval * 1000);
+  taskBusyBegin(TASK_CONTROL);
+  traceBegin(TRACK_CONTROL, "sample");
+
+  uint32_t acquireStart = cycleCount();
+  currentMoisture = probe.read();
+
+  MoistureSample sample;
+  sample.timeMs = halMillis();
+  sample.raw = currentMoisture;
+  sample.percent = moisturePercent(currentMoisture);
+  sample.flags = (relayOn ? SAMPLE_RELAY_ON : 0) |
+                 (buzzerOn ? SAMPLE_BUZZER_ON : 0) |
+                 (controller.wifiMode() ? SAMPLE_WIFI_MODE : 0);
+  samples.push(sample);
+  latency(LAT_SAMPLING).record(cycleCount() - acquireStart);
+
+  // Pulses since the previous sample go to the zone whose relay was on
+  // for that interval, i.e. before this sample's decision
+  waterUsage.update(flowMeter.poll(), sample.timeMs - lastFlowPollMs, relayOn ? 0 : -1,
+                    (uint32_t)(halMicros() / 1000000));
+  lastFlowPollMs = sample.timeMs;
+
+  // Only process moisture if not in menu mode
+  while (samples.pop(READER_CONTROL, sample)) {
+    if (!controller.menuActive() && controller.sensorReady()) {
+      processIrrigation(sample.percent);
+      bootMark(BOOT_FIRST_DECISION);
+    }
+
+    ControllerSnapshot snap;
+    snap.timeMs = sample.timeMs;
+    snap.raw = sample.raw;
+    snap.percent = sample.percent;
+    snap.threshold = controller.threshold();
+    snap.wifiMode = controller.wifiMode();
+    snap.relayOn = relayOn;
+    snap.buzzerOn = buzzerOn;
+    snap.menuActive = controller.menuActive();
+    snap.sensorReady = controller.sensorReady();
+    controller.publish(snap);
+  }
+
+  bootMark(BOOT_FIRST_SAMPLE);
+
+  traceEnd(TRACK_CONTROL, "sample");
+  taskBusyEnd(TASK_CONTROL);
+  uiCoroutines.signal(EVENT_ADC_BURST);
+}
+
+void uiBegin() {
+  uiTimers.advance(halMillis());
+  uiTimers.start(buttonTimer, buttonPollInterval, buttonPollInterval);
+  uiTimers.start(displayTimer, displayRefreshInterval, displayRefreshInterval);
+  uiTimers.start(usageCommitTimer, usageCommitInterval, usageCommitInterval);
+  uiTimers.start(latencyReportTimer, latencyReportInterval, latencyReportInterval);
+  uiTimers.start(heapSampleTimer, 0, heapSampleInterval);
+}
+
+uint32_t uiPoll() {
+  powerTaskRunning(TASK_UI);
+  taskBusyBegin(TASK_UI);
+  uiTimers.advance(halMillis());
+  uiCoroutines.run();
+  taskBusyEnd(TASK_UI);
+  uint32_t wait = uiTimers.ticksUntilNext(halMillis(), buttonPollInterval);
+  powerTaskBlocking(TASK_UI, wait);
+  return wait;
+}
+
+void pollButtons(void* arg) {
+  static int seenThreshold = controller.threshold();
+  static bool seenMode = controller.wifiMode();
+  static uint32_t seenSessions = 0;
+  static bool seenAp = false;
+
+  handleMenu();
+
+  if (accessPoint.on() != seenAp) {
+    seenAp = !seenAp;
+    queueUiMessage(seenAp ? "WiFi AP on" : "WiFi AP off");
+    uiCoroutines.signal(EVENT_UI_MESSAGE);
+  }
+
+  if (controller.wifiMode() != seenMode) {
+    seenMode = !seenMode;
+    const char* message = seenMode ? "WiFi Mode" : "Manual Mode";
+    queueUiMessage(message);
+    uiCoroutines.signal(EVENT_UI_MESSAGE);
+  }
+
+  // Batch rapid +/- presses into a single NVS write
+  int threshold = controller.threshold();
+  if (threshold != seenThreshold) {
+    seenThreshold = threshold;
+    uiTimers.start(prefCommitTimer, prefCommitDelay);
+  }
+
+  // Persist water totals shortly after each session, then periodically
+  uint32_t sessions = waterUsage.snapshot().sessions;
+  if (sessions != seenSessions) {
+    seenSessions = sessions;
+    uiTimers.start(usageCommitTimer, prefCommitDelay, usageCommitInterval);
+  }
+}
+
+void commitThreshold(void* arg) {
+  LatencyScope scope(latency(LAT_PREF_COMMIT));
+  TraceScope trace(TRACK_UI, "nvs-threshold");
+  halStoragePutInt(thresh, controller.threshold());
+}
+
+void commitWaterUsage(void* arg) {
+  LatencyScope scope(latency(LAT_PREF_COMMIT));
+  TraceScope trace(TRACK_UI, "nvs-water");
+  WaterUsageSnapshot usage = waterUsage.snapshot();
+  for (int z = 0; z < waterZoneCount; z++) {
+    if (usage.zones[z].totalMl != committedZoneMl[z]) {
+      char key[16];
+      snprintf(key, sizeof(key), "zone%dMl", z);
+      halStoragePutUInt(key, usage.zones[z].totalMl);
+      committedZoneMl[z] = usage.zones[z].totalMl;
+    }
+  }
+}
+
+void reportLatency(void* arg) {
+  latencyReport();
+}
+
+void sampleHeap(void* arg) {
+  uint8_t raised = heapMonitor.sample((uint32_t)(halMicros() / 1000000));
+  if (raised) {
+    HeapHealth h = heapMonitor.health();
+    halPrintf("Heap warning: %s (free %u, largest block %u, %d B/h)\n",
+              HeapMonitor::warningText(raised), (unsigned)h.latest.freeBytes,
+              (unsigned)h.latest.largestBlock, (int)h.blockSlopePerHour);
+    queueUiMessage(HeapMonitor::warningText(raised));
+    uiCoroutines.signal(EVENT_UI_MESSAGE);
+  }
+}
+
+void refreshDisplay(void* arg) {
+  updateDisplay();
+}
+
+void repeatThresholdStep(void* arg) {
+  controller.post(CMD_ADJUST_THRESHOLD, heldThresholdStep);
+  updateDisplay();
+}
+
+void timerWheelJson(TextBuffer& out, const TimerWheel& wheel) {
+  const TimerWheelStats& stats = wheel.stats();
+  uint32_t meanLateUs = stats.fired ? (uint32_t)((uint64_t)stats.totalLate * 1000 / stats.fired) : 0;
+  out.appendf("{\"fired\":%u,\"late\":%u,\"maxLateMs\":%u,\"meanLateUs\":%u,\"timers\":[",
+              (unsigned)stats.fired, (unsigned)stats.late, (unsigned)stats.maxLate,
+              (unsigned)meanLateUs);
+  for (WheelTimer* t = wheel.timers(); t; t = t->registryNext) {
+    out.appendf("%s{\"name\":\"%s\",\"active\":%s,\"fired\":%u,\"maxLateMs\":%u}",
+                t != wheel.timers() ? "," : "", t->name, t->active ? "true" : "false",
+                (unsigned)t->fired, (unsigned)t->maxLate);
+  }
+  out.append("]}");
+}
+
+void statusJson(TextBuffer& json) {
+  // Sampling and relay control belong to the control task, just report
+  ControllerSnapshot snap = controller.snapshot();
+  bool irrigating = snap.relayOn;
+
+  // Mode and threshold both live, so a toggle shows up at once alongside
+  // the threshold it applies to; the relay follows at the next sample
+  const char* status;
+  if (controller.wifiMode()) {
+    // WiFi mode
+    status = irrigating ? "Irrigating (WiFi)" : "Idle (WiFi)";
+  } else {
+    // Manual mode
+    status = irrigating ? "Irrigating (Manual)" : "Idle (Manual)";
+  }
+
+  WaterUsageSnapshot usage = waterUsage.snapshot();
+
+  json.appendf("{\"moisture\":%u,\"threshold\":%d,\"status\":\"%s\",\"water\":{\"flowLpm\":",
+               snap.percent, controller.threshold(), status);
+  appendLiters(json, usage.flowMlPerMin);
+  json.appendf(",\"sessionActive\":%s,\"sessionL\":", usage.sessionZone >= 0 ? "true" : "false");
+  appendLiters(json, usage.sessionMl);
+  json.appendf(",\"sessionSeconds\":%u,\"todayL\":", (unsigned)usage.sessionSeconds);
+  appendLiters(json, usage.todayMl);
+  json.append(",\"yesterdayL\":");
+  appendLiters(json, usage.yesterdayMl);
+  json.append(",\"zones\":[");
+  for (int z = 0; z < waterZoneCount; z++) {
+    json.appendf("%s{\"zone\":%d,\"sessions\":%u,\"todayL\":", z ? "," : "", z,
+                 (unsigned)usage.zones[z].sessions);
+    appendLiters(json, usage.zones[z].todayMl);
+    json.append(",\"totalL\":");
+    appendLiters(json, usage.zones[z].totalMl);
+    json.append("}");
+  }
+  json.append("]}}");
+}
+
+TextBuffer beginResponse() {
+  requestArena.reset();
+  size_t size;
+  char* data = requestArena.allocateRest(size);
+  return TextBuffer(data, size);
+}
+
+// Every route goes through the tracer; the send helpers below report the
+// body bytes of the request in progress
+void route(const char* path, HalHttpHandler handler) {
+  int id = routes.add(path);
+  halHttpOn(path, [id, path, handler]() {
+    TraceScope trace(TRACK_NETWORK, path);
+    routes.begin(id);
+    handler();
+    routes.end();
+    lastRequestMs = halMillis();
+  });
+}
+
+uint32_t httpLastRequestMs() {
+  return lastRequestMs;
+}
+
+bool queryInt(const char* name, long& value) {
+  char text[12];
+  if (!halHttpArg(name, text, sizeof(text))) {
+    return false;
+  }
+  value = atol(text);
+  return true;
+}
+
+void sendText(const char* type, const char* text) {
+  size_t length = strlen(text);
+  routes.addBytes(length);
+  halHttpSend(200, type, text, length);
+}
+
+void sendBody(const TextBuffer& body, const char* type) {
+  if (body.overflowed()) {
+    // An error, so not counted as route output
+    static const char tooLarge[] = "Response too large";
+    halHttpSend(500, "text/plain", tooLarge, sizeof(tooLarge) - 1);
+    return;
+  }
+  routes.addBytes(body.length());
+  halHttpSend(200, type, body.c_str(), body.length());
+}
+
+void sendJson(const TextBuffer& body) {
+  sendBody(body, "application/json");
+}
+
+void appendLiters(TextBuffer& out, uint32_t ml) {
+  out.appendf("%u.%03u", (unsigned)(ml / 1000), (unsigned)(ml % 1000));
+}
+
+// Chunked responses are built in a 1 KB arena chunk and flushed well
+// before it fills, TextBuffer truncates on overflow
+static const size_t chunkBytes = 1024;
+static const size_t chunkFlushMargin = 96;
+
+TextBuffer beginChunked() {
+  requestArena.reset();
+  halHttpBeginChunked("application/json");
+  return TextBuffer(static_cast<char*>(requestArena.allocate(chunkBytes, 1)), chunkBytes);
+}
+
+void flushChunk(TextBuffer& chunk, bool force) {
+  if (force || chunk.length() + chunkFlushMargin > chunk.capacity()) {
+    routes.addBytes(chunk.length());
+    halHttpSendChunk(chunk.c_str(), chunk.length());
+    chunk.clear();
+  }
+  if (force) {
+    halHttpEndChunked();
+  }
+}
+
+void streamHistory(uint32_t from) {
+  TextBuffer chunk = beginChunked();
+  chunk.appendf("{\"resolution\":1,\"oldest\":%u,\"newest\":%u,\"points\":%u,"
+                "\"centibitsPerPoint\":%u,\"data\":[",
+                (unsigned)history.oldestTime(), (unsigned)history.newestTime(),
+                (unsigned)history.points(), (unsigned)history.centibitsPerPoint());
+
+  MoistureHistory::Reader reader = history.read(from);
+  HistoryPoint point;
+  for (int n = 0; reader.next(point); n++) {
+    chunk.appendf("%s[%u,%u,%u]", n ? "," : "", (unsigned)point.time, point.percent, point.flags);
+    flushChunk(chunk, false);
+  }
+  chunk.append("]}");
+  flushChunk(chunk, true);
+}
+
+// Buckets as [start, min, max, mean, count, pumpSeconds], gaps omitted
+void streamRollup(const RollupRing& ring, uint32_t from) {
+  TextBuffer chunk = beginChunked();
+  chunk.appendf("{\"resolution\":%u,\"data\":[", (unsigned)ring.resolution());
+
+  int n = 0;
+  for (uint16_t i = ring.find(from); i < ring.size(); i++) {
+    const RollupBucket& b = ring.at(i);
+    if (!b.count) {
+      continue;
+    }
+    uint32_t mean10 = (uint32_t)b.mean().roundTimes(10);
+    chunk.appendf("%s[%u,%u,%u,%u.%u,%u,%u]", n++ ? "," : "", (unsigned)ring.startOf(i),
+                  b.min, b.max, (unsigned)(mean10 / 10), (unsigned)(mean10 % 10),
+                  (unsigned)b.count, (unsigned)b.pumpSeconds);
+    flushChunk(chunk, false);
+  }
+  chunk.append("]}");
+  flushChunk(chunk, true);
+}
+
+Fixed16 moistureLevel(uint32_t reading) {
+  return calibratedMoisture(reading, probeCalibration);
+}
+
+int moisturePercent(uint32_t reading) {
+  return calibratedPercent(reading, probeCalibration);
+}
+
+void processIrrigation(int moisturePercentage) {
+  LatencyScope scope(latency(LAT_IRRIGATION));
+
+  // Control relay based on moisture and system mode: every sample in
+  // manual mode, only after a /status poll in WiFi mode
+  bool statusPolled = controller.takeStatusPoll();
+  if (!controller.wifiMode() || statusPolled) {
+    bool wasOn = relayOn;
+    relayOn = moisturePercentage < controller.threshold();
+    if (relayOn != wasOn) {
+      traceInstant(TRACK_CONTROL, relayOn ? "relay-on" : "relay-off");
+      powerHold(POWER_HOLD_PUMP, relayOn);
+    }
+    RelayOutput::write(relayOn);
+  }
+
+  // Critical moisture alert
+  buzzerOn = moisturePercentage < 20;
+  BuzzerOutput::write(buzzerOn);
+}
+
+void updateDisplay() {
+  LatencyScope scope(latency(LAT_DISPLAY));
+  TraceScope trace(TRACK_UI, "lcd-i2c");
+  char line[17];
+
+  if (flashMessage) {
+    halDisplayLine(0, flashMessage);
+    halDisplayLine(1, "");
+    return;
+  }
+
+  if (menuActive) {
+    snprintf(line, sizeof(line), "%d%%", controller.threshold());
+    halDisplayLine(0, "Set Threshold:");
+    halDisplayLine(1, line);
+    return;
+  }
+
+  if (diagnosticsActive) {
+    // "H123k B45k F63%" / "Stk 5.1 1.8 2.2": free heap, largest block,
+    // fragmentation, then each task's free stack in KB
+    HeapHealth h = heapMonitor.health();
+    TextBuffer row(line, sizeof(line));
+    row.appendf("H%uk B%uk F%u%%", (unsigned)(h.latest.freeBytes / 1024),
+                (unsigned)(h.latest.largestBlock / 1024),
+                (unsigned)(h.latest.fragmentationPermille / 10));
+    halDisplayLine(0, line);
+    row.clear();
+    row.append("Stk");
+    for (int i = 0; i < TASK_COUNT; i++) {
+      unsigned tenths = h.latest.stackFree[i] * 10 / 1024;
+      row.appendf(" %u.%u", tenths / 10, tenths % 10);
+    }
+    halDisplayLine(1, line);
+    return;
+  }
+
+  ControllerSnapshot snap = controller.snapshot();
+  snprintf(line, sizeof(line), "Moisture: %d%%", snap.percent);
+  halDisplayLine(0, line);
+  if (!snap.sensorReady) {
+    halDisplayLine(1, "Warming up");
+  } else {
+    halDisplayLine(1, snap.relayOn ? "Irrigating" : "Idle");
+  }
+}
+
+void handleMenu() {
+  LatencyScope scope(latency(LAT_MENU));
+  uint32_t buttons = ButtonInputs::read();
+  bool menuButtonState = ButtonInputs::level<Board::menuButtonPin>(buttons);
+  bool plusButtonState = ButtonInputs::level<Board::plusButtonPin>(buttons);
+  bool minusButtonState = ButtonInputs::level<Board::minusButtonPin>(buttons);
+
+  // Check for menu button press, ignoring bounces while the lockout runs
+  if (!menuButtonState && lastMenuButtonState && !debounceTimer.active) {
+    menuActive = !menuActive;
+    controller.post(CMD_SET_MENU_ACTIVE, menuActive);
+    updateDisplay();
+    uiTimers.start(debounceTimer, debounceDelay);
+  }
+  lastMenuButtonState = menuButtonState;
+
+  // Plus outside the menu flips the LCD to the heap/stack diagnostics
+  if (!menuActive && !plusButtonState && lastPlusButtonState && !debounceTimer.active) {
+    diagnosticsActive = !diagnosticsActive;
+    updateDisplay();
+    uiTimers.start(debounceTimer, debounceDelay);
+  }
+  lastPlusButtonState = plusButtonState;
+
+  // Minus outside the menu brings the access point back (or keeps it up)
+  if (!menuActive && !minusButtonState && lastMinusButtonState && !debounceTimer.active) {
+    accessPoint.request();
+    uiTimers.start(debounceTimer, debounceDelay);
+  }
+  lastMinusButtonState = minusButtonState;
+
+  // Menu active - allow threshold adjustment. A press steps at once and
+  // holding repeats; the control task applies (and clamps) each step as
+  // soon as it is posted, it outranks this task.
+  int step = 0;
+  if (menuActive) {
+    if (!plusButtonState) {
+      step = 1;
+    } else if (!minusButtonState) {
+      step = -1;
+    }
+  }
+
+  if (step != heldThresholdStep) {
+    heldThresholdStep = step;
+    if (step) {
+      repeatThresholdStep(nullptr);
+      uiTimers.start(thresholdRepeatTimer, thresholdAdjustInterval, thresholdAdjustInterval);
+    } else {
+      uiTimers.stop(thresholdRepeatTimer);
+    }
+  }
+}
@@ -0,0 +1,123 @@
+#include "controller_state.h"
+
+static int clampPercent(int value) {
+  return value < 0 ? 0 : value > 100 ? 100 : value;
+}
+
+#if defined(ESP32)
+
+ControllerState::ControllerState()
+    : threshold_(40), wifiMode_(false), menuActive_(false), sensorReady_(false),
+      dropped_(0), statusPolled_(false), commands_(nullptr) {}
+
+void ControllerState::begin(int threshold, bool wifiMode) {
+  threshold_.store(threshold, std::memory_order_relaxed);
+  wifiMode_.store(wifiMode, std::memory_order_relaxed);
+  commands_ = xQueueCreateStatic(queueLength, sizeof(ControllerCommand), queueStorage_,
+                                 &queueBuffer_);
+}
+
+bool ControllerState::post(ControllerCommandType type, int16_t value) {
+  ControllerCommand cmd = { type, value };
+  if (xQueueSend(commands_, &cmd, 0) != pdTRUE) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool ControllerState::waitForCommand(uint32_t timeoutMs) {
+  ControllerCommand cmd;
+  return xQueuePeek(commands_, &cmd, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+bool ControllerState::applyNext() {
+  ControllerCommand cmd;
+  if (xQueueReceive(commands_, &cmd, 0) != pdTRUE) {
+    return false;
+  }
+  apply(cmd);
+  return true;
+}
+
+#else
+
+ControllerState::ControllerState()
+    : threshold_(40), wifiMode_(false), menuActive_(false), sensorReady_(false),
+      dropped_(0), statusPolled_(false), queueHead_(0), queueCount_(0) {}
+
+void ControllerState::begin(int threshold, bool wifiMode) {
+  threshold_.store(threshold, std::memory_order_relaxed);
+  wifiMode_.store(wifiMode, std::memory_order_relaxed);
+}
+
+bool ControllerState::post(ControllerCommandType type, int16_t value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (queueCount_ == queueLength) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  ControllerCommand cmd = { type, value };
+  queue_[(queueHead_ + queueCount_++) % queueLength] = cmd;
+  queued_.notify_one();
+  return true;
+}
+
+bool ControllerState::waitForCommand(uint32_t timeoutMs) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return queued_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                          [this] { return queueCount_ > 0; });
+}
+
+bool ControllerState::applyNext() {
+  ControllerCommand cmd;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queueCount_ == 0) {
+      return false;
+    }
+    cmd = queue_[queueHead_];
+    queueHead_ = (queueHead_ + 1) % queueLength;
+    queueCount_--;
+  }
+  apply(cmd);
+  return true;
+}
+
+#endif
+
+void ControllerState::apply(const ControllerCommand& cmd) {
+  switch (cmd.type) {
+    case CMD_SET_THRESHOLD:
+      threshold_.store(clampPercent(cmd.value), std::memory_order_relaxed);
+      break;
+    case CMD_ADJUST_THRESHOLD:
+      threshold_.store(clampPercent(threshold() + cmd.value), std::memory_order_relaxed);
+      break;
+    case CMD_TOGGLE_MODE:
+      wifiMode_.store(!wifiMode(), std::memory_order_relaxed);
+      break;
+    case CMD_SET_MODE:
+      wifiMode_.store(cmd.value != 0, std::memory_order_relaxed);
+      break;
+    case CMD_SET_MENU_ACTIVE:
+      menuActive_.store(cmd.value != 0, std::memory_order_relaxed);
+      break;
+    case CMD_SET_SENSOR_READY:
+      sensorReady_.store(cmd.value != 0, std::memory_order_relaxed);
+      break;
+    case CMD_STATUS_POLLED:
+      statusPolled_ = true;
+      break;
+  }
+}
+
+bool ControllerState::takeStatusPoll() {
+  bool polled = statusPolled_;
+  statusPolled_ = false;
+  return polled;
+}
+
+void ControllerState::publish(const ControllerSnapshot& snapshot) {
+  snapshot_.write(snapshot);
+}
@@ -0,0 +1,92 @@
+#include "coroutine.h"
+
+#include <string.h>
+
+CoFrame::CoFrame()
+    : line_(0), scheduler_(nullptr), timer_("coroutine", onTimer, this),
+      waitEvents_(0), wokenBy_(0), runnable_(true) {
+  // Pool slots are reused, keep frame timers out of the wheel's registry
+  timer_.registered = true;
+}
+
+void CoFrame::onTimer(void* arg) {
+  static_cast<CoFrame*>(arg)->runnable_ = true;
+}
+
+void CoFrame::sleepFor(uint32_t ms) {
+  waitEvents_ = 0;
+  scheduler_->wheel_.start(timer_, ms);
+}
+
+void CoFrame::waitFor(uint32_t events, uint32_t timeoutMs) {
+  waitEvents_ = events;
+  if (timeoutMs) {
+    scheduler_->wheel_.start(timer_, timeoutMs);
+  }
+}
+
+CoScheduler::CoScheduler(TimerWheel& wheel)
+    : wheel_(wheel), wakeHook_(nullptr), wakeArg_(nullptr), pending_(0),
+      resumes_(0), spawnFailures_(0) {
+  memset(frames_, 0, sizeof(frames_));
+}
+
+void CoScheduler::setWakeHook(WakeHook hook, void* arg) {
+  wakeHook_ = hook;
+  wakeArg_ = arg;
+}
+
+int CoScheduler::freeSlot() const {
+  for (int i = 0; i < frameSlots; i++) {
+    if (!frames_[i]) return i;
+  }
+  return -1;
+}
+
+int CoScheduler::active() const {
+  int count = 0;
+  for (int i = 0; i < frameSlots; i++) {
+    if (frames_[i]) count++;
+  }
+  return count;
+}
+
+void CoScheduler::attach(int slot, CoFrame* frame) {
+  frame->scheduler_ = this;
+  frames_[slot] = frame;
+}
+
+void CoScheduler::signal(uint32_t events) {
+  pending_.fetch_or(events, std::memory_order_release);
+  if (wakeHook_) {
+    wakeHook_(wakeArg_);
+  }
+}
+
+void CoScheduler::run() {
+  uint32_t events = pending_.exchange(0, std::memory_order_acquire);
+
+  for (int i = 0; i < frameSlots; i++) {
+    CoFrame* frame = frames_[i];
+    if (!frame) continue;
+
+    uint32_t hit = frame->waitEvents_ & events;
+    if (hit) {
+      frame->runnable_ = true;
+    }
+    if (!frame->runnable_) continue;
+
+    // Whichever of event/timeout woke the frame, cancel the other
+    frame->wokenBy_ = hit;
+    frame->waitEvents_ = 0;
+    frame->runnable_ = false;
+    wheel_.stop(frame->timer_);
+
+    resumes_++;
+    if (frame->resume() == CO_DONE) {
+      wheel_.stop(frame->timer_);
+      frame->~CoFrame();
+      frames_[i] = nullptr;
+    }
+  }
+}
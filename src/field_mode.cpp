@@ -0,0 +1,109 @@
+#include "field_mode.h"
+
+#include <string.h>
+
+#include "controller.h"
+#include "moisture_probe.h"
+#include "gpio.h"
+
+#if defined(FIELD_MODE) && defined(MOISTURE_PROBE_FREQUENCY)
+#error "field mode needs the analog probe: one frequency gate alone takes 100 ms"
+#endif
+
+static const uint32_t fieldMagic = 0x46494c32;   // "FIL2"
+static const int fieldBurstSize = 16;
+static constexpr Fixed16 fieldSmoothing = Fixed16::fromFloat(0.25f);   // EMA weight per cycle
+
+RTC_DATA_ATTR static FieldState state;
+
+static AnalogProbe fieldProbe(Board::moisturePin, fieldBurstSize);
+
+FieldAction fieldCycle(HalWakeCause wake) {
+  uint64_t now = halRtcMicros();
+
+  // Re-drive the held level before releasing the hold, so the relay
+  // doesn't drop out between cycles
+  bool coldBoot = state.magic != fieldMagic;
+  RelayOutput::begin(!coldBoot && state.relayOn);
+  halHoldOutput(RelayOutput::pin, false);
+  BuzzerOutput::begin(false);
+
+  if (coldBoot) {
+    memset(&state, 0, sizeof(state));
+    state.magic = fieldMagic;
+    halStorageBegin("pref");
+    state.threshold = halStorageGetInt("threshold", 40);
+  } else if (state.relayOn) {
+    state.relayOnSeconds += (uint32_t)((now - state.wakeRtcUs) / 1000000);
+  }
+  state.wakeRtcUs = now;
+  state.cycles++;
+
+  fieldProbe.begin();
+  Fixed16 moisture = moistureLevel(fieldProbe.read());
+  if (coldBoot) {
+    state.moisture = moisture;
+  } else {
+    state.moisture += (moisture - state.moisture) * fieldSmoothing;
+  }
+  // Rounded up, like calibratedPercent()
+  int percent = state.moisture.ceil();
+  state.relayOn = percent < state.threshold;
+  RelayOutput::write(state.relayOn);
+
+  state.history[state.historyHead++ % fieldHistorySize] =
+      (uint8_t)percent | (state.relayOn ? fieldHistoryRelay : 0);
+
+  halPrintf("field: cycle %u %d%% %s, previous cycle awake %u.%u ms\n", (unsigned)state.cycles,
+            percent, state.relayOn ? "watering" : "idle", (unsigned)(state.lastAwakeUs / 1000),
+            (unsigned)(state.lastAwakeUs / 100 % 10));
+
+  if (wake == HAL_WAKE_GPIO || state.cycles % FIELD_WEB_EVERY == 0) {
+    return FIELD_WEB_WINDOW;
+  }
+  return FIELD_SLEEP;
+}
+
+void fieldSleep(bool relayOn, int threshold) {
+  state.relayOn = relayOn;
+  state.threshold = threshold;
+  RelayOutput::write(relayOn);
+  halHoldOutput(RelayOutput::pin, true);
+
+  uint32_t awake = (uint32_t)halMicros();
+  state.lastAwakeUs = awake;
+  state.totalAwakeUs += awake;
+  if (awake > state.maxAwakeUs) {
+    state.maxAwakeUs = awake;
+  }
+  uint64_t interval = relayOn ? FIELD_WATERING_INTERVAL_S : FIELD_SAMPLE_INTERVAL_S;
+  halDeepSleep(interval * 1000000, MenuButtonInput::pin);
+}
+
+bool fieldWebWindowOver() {
+  return halMillis() >= (uint32_t)FIELD_WEB_WINDOW_S * 1000;
+}
+
+const FieldState& fieldState() {
+  return state;
+}
+
+// History oldest first, as [percent, relay] pairs
+void fieldJson(TextBuffer& out) {
+  uint32_t cycles = state.cycles ? state.cycles : 1;
+  out.appendf("{\"cycles\":%u,\"threshold\":%d,\"relayOn\":%s,\"relayOnSeconds\":%u,"
+              "\"awakeUs\":{\"last\":%u,\"max\":%u,\"avg\":%u},"
+              "\"intervalS\":%u,\"wateringIntervalS\":%u,\"history\":[",
+              (unsigned)state.cycles, (int)state.threshold, state.relayOn ? "true" : "false",
+              (unsigned)state.relayOnSeconds, (unsigned)state.lastAwakeUs,
+              (unsigned)state.maxAwakeUs, (unsigned)(state.totalAwakeUs / cycles),
+              (unsigned)FIELD_SAMPLE_INTERVAL_S, (unsigned)FIELD_WATERING_INTERVAL_S);
+  uint32_t count = state.historyHead < (uint32_t)fieldHistorySize ? state.historyHead
+                                                                   : fieldHistorySize;
+  for (uint32_t i = state.historyHead - count; i != state.historyHead; i++) {
+    uint8_t e = state.history[i % fieldHistorySize];
+    out.appendf("%s[%u,%u]", i != state.historyHead - count ? "," : "",
+                e & ~fieldHistoryRelay, (e & fieldHistoryRelay) ? 1 : 0);
+  }
+  out.append("]}");
+}
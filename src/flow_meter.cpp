@@ -0,0 +1,65 @@
+#include "flow_meter.h"
+
+FlowMeter::FlowMeter(int pin, int pcntUnit) : pin_(pin), unit_(pcntUnit), last_(0) {}
+
+#if defined(ESP32)
+
+#include <driver/pcnt.h>
+
+// Glitch filter in APB cycles (80 MHz): pulses shorter than ~12.8 us are
+// ignored. Hall sensors switch cleanly, this only rejects relay noise.
+static const uint16_t glitchFilterCycles = 1023;
+
+bool FlowMeter::begin() {
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = pin_;
+  config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = (pcnt_unit_t)unit_;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DIS;
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = counterLimit;
+  config.counter_l_lim = 0;
+
+  if (pcnt_unit_config(&config) != ESP_OK) {
+    return false;
+  }
+  pcnt_set_filter_value((pcnt_unit_t)unit_, glitchFilterCycles);
+  pcnt_filter_enable((pcnt_unit_t)unit_);
+
+  pcnt_counter_pause((pcnt_unit_t)unit_);
+  pcnt_counter_clear((pcnt_unit_t)unit_);
+  pcnt_counter_resume((pcnt_unit_t)unit_);
+  last_ = 0;
+  return true;
+}
+
+uint32_t FlowMeter::poll() {
+  int16_t count;
+  if (pcnt_get_counter_value((pcnt_unit_t)unit_, &count) != ESP_OK) {
+    return 0;
+  }
+  // The counter resets to 0 on reaching the high limit
+  int32_t delta = (int32_t)count - last_;
+  if (delta < 0) {
+    delta += counterLimit;
+  }
+  last_ = count;
+  return (uint32_t)delta;
+}
+
+#else
+
+#include "hal_native.h"
+
+bool FlowMeter::begin() {
+  return true;
+}
+
+uint32_t FlowMeter::poll() {
+  return nativeTakePulses(pin_);
+}
+
+#endif
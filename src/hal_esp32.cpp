@@ -0,0 +1,279 @@
+#if defined(ESP32)
+
+#include "hal.h"
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+#include <Preferences.h>
+#include <WebServer.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <driver/gpio.h>
+#include <driver/rtc_io.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <new>
+#include <stdarg.h>
+#include <sys/time.h>
+
+static LiquidCrystal_I2C lcd(0x27, halDisplayColumns, halDisplayRows);
+static Preferences pref;
+
+static WiFiClient tcp;
+
+// Falling-edge handlers, also the light-sleep wake sources
+static const int maxEdgePins = 4;
+static int edgePins[maxEdgePins];
+static HalIsr edgeIsrs[maxEdgePins];
+static int edgePinCount = 0;
+
+// Constructed in place by halHttpBegin() so the port comes from the caller
+alignas(WebServer) static uint8_t serverStorage[sizeof(WebServer)];
+static WebServer* server = nullptr;
+
+uint32_t halMillis() {
+  return millis();
+}
+
+uint64_t halMicros() {
+  return (uint64_t)esp_timer_get_time();
+}
+
+void halPinMode(int pin, HalPinMode mode) {
+  pinMode(pin, mode == HAL_OUTPUT ? OUTPUT : mode == HAL_INPUT_PULLUP ? INPUT_PULLUP : INPUT);
+}
+
+void halDigitalWrite(int pin, bool high) {
+  digitalWrite(pin, high ? HIGH : LOW);
+}
+
+bool halDigitalRead(int pin) {
+  return digitalRead(pin) == HIGH;
+}
+
+uint16_t halAnalogRead(int pin) {
+  return analogRead(pin);
+}
+
+void halAttachFallingEdge(int pin, HalIsr isr) {
+  attachInterrupt(pin, isr, FALLING);
+  if (edgePinCount < maxEdgePins) {
+    edgePins[edgePinCount] = pin;
+    edgeIsrs[edgePinCount++] = isr;
+  }
+}
+
+void halDisplayBegin() {
+  lcd.init();
+  lcd.backlight();
+  lcd.clear();
+}
+
+void halDisplayLine(uint8_t row, const char* text) {
+  char line[halDisplayColumns + 1];
+  snprintf(line, sizeof(line), "%-16s", text);
+  lcd.setCursor(0, row);
+  lcd.print(line);
+}
+
+void halDisplayBacklight(bool on) {
+  if (on) {
+    lcd.backlight();
+  } else {
+    lcd.noBacklight();
+  }
+}
+
+void halStorageBegin(const char* ns) {
+  pref.begin(ns, false);
+}
+
+int32_t halStorageGetInt(const char* key, int32_t fallback) {
+  return pref.getInt(key, fallback);
+}
+
+void halStoragePutInt(const char* key, int32_t value) {
+  pref.putInt(key, value);
+}
+
+uint32_t halStorageGetUInt(const char* key, uint32_t fallback) {
+  return pref.getUInt(key, fallback);
+}
+
+void halStoragePutUInt(const char* key, uint32_t value) {
+  pref.putUInt(key, value);
+}
+
+size_t halStorageGetBytes(const char* key, void* out, size_t size) {
+  size_t length = pref.getBytesLength(key);
+  if (length == 0 || length > size) {
+    return 0;
+  }
+  return pref.getBytes(key, out, size);
+}
+
+void halStoragePutBytes(const char* key, const void* data, size_t length) {
+  pref.putBytes(key, data, length);
+}
+
+void halStorageRemove(const char* key) {
+  pref.remove(key);
+}
+
+void halHttpBegin(uint16_t port) {
+  server = new (serverStorage) WebServer(port);
+  server->begin();
+}
+
+void halHttpOn(const char* path, HalHttpHandler handler) {
+  server->on(path, HTTP_GET, handler);
+}
+
+void halHttpPoll() {
+  server->handleClient();
+}
+
+// Short query args fit String's inline buffer
+bool halHttpArg(const char* name, char* out, size_t size) {
+  if (!server->hasArg(name)) {
+    return false;
+  }
+  strlcpy(out, server->arg(name).c_str(), size);
+  return true;
+}
+
+// Bodies go out through send_P so no String copy of them is made
+void halHttpSend(int code, const char* type, const char* body, size_t length) {
+  server->send_P(code, type, body, length);
+}
+
+void halHttpBeginChunked(const char* type) {
+  server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server->send_P(200, type, "");
+}
+
+void halHttpSendChunk(const char* data, size_t length) {
+  server->sendContent(data, length);
+}
+
+void halHttpEndChunked() {
+  server->sendContent("", 0);
+}
+
+bool halTcpLinkUp() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+bool halTcpConnect(const char* host, uint16_t port, uint32_t timeoutMs) {
+  tcp.stop();
+  if (!tcp.connect(host, port, timeoutMs)) {
+    return false;
+  }
+  tcp.setNoDelay(true);
+  return true;
+}
+
+bool halTcpWrite(const uint8_t* data, size_t length) {
+  return tcp.write(data, length) == length;
+}
+
+int halTcpRead(uint8_t* out, size_t size) {
+  int available = tcp.available();
+  if (available > 0) {
+    return tcp.read(out, (size_t)available < size ? available : size);
+  }
+  return tcp.connected() ? 0 : -1;
+}
+
+void halTcpClose() {
+  tcp.stop();
+}
+
+void halPrintf(const char* format, ...) {
+  char line[160];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  Serial.print(line);
+}
+
+uint32_t halFreeHeap() {
+  return ESP.getFreeHeap();
+}
+
+uint32_t halLargestFreeBlock() {
+  return ESP.getMaxAllocHeap();
+}
+
+// GPIO wake-up needs level interrupts, which would retrigger the edge
+// handlers while a button is held, so they're only switched over for the
+// duration of the sleep
+HalWakeCause halLightSleep(uint64_t us) {
+  for (int i = 0; i < edgePinCount; i++) {
+    if (!digitalRead(edgePins[i])) {
+      return HAL_WAKE_NONE;
+    }
+  }
+  for (int i = 0; i < edgePinCount; i++) {
+    gpio_wakeup_enable((gpio_num_t)edgePins[i], GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(us);
+  esp_err_t err = esp_light_sleep_start();
+  for (int i = 0; i < edgePinCount; i++) {
+    gpio_wakeup_disable((gpio_num_t)edgePins[i]);
+    gpio_set_intr_type((gpio_num_t)edgePins[i], GPIO_INTR_NEGEDGE);
+  }
+  if (err != ESP_OK) {
+    return HAL_WAKE_NONE;
+  }
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_GPIO) {
+    return HAL_WAKE_TIMER;
+  }
+  for (int i = 0; i < edgePinCount; i++) {
+    if (!digitalRead(edgePins[i])) {
+      edgeIsrs[i]();
+    }
+  }
+  return HAL_WAKE_GPIO;
+}
+
+// Backed by the RTC timer, which deep sleep leaves running
+uint64_t halRtcMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+HalWakeCause halDeepSleepWakeCause() {
+  switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_TIMER:
+      return HAL_WAKE_TIMER;
+    case ESP_SLEEP_WAKEUP_EXT0:
+      return HAL_WAKE_GPIO;
+    default:
+      return HAL_WAKE_NONE;
+  }
+}
+
+void halHoldOutput(int pin, bool hold) {
+  if (hold) {
+    gpio_hold_en((gpio_num_t)pin);
+  } else {
+    gpio_hold_dis((gpio_num_t)pin);
+  }
+}
+
+// ext0 keeps the RTC peripherals powered, so the pin's RTC pull-up holds
+// the button high until it is pressed
+void halDeepSleep(uint64_t us, int wakePin) {
+  gpio_deep_sleep_hold_en();
+  rtc_gpio_pullup_en((gpio_num_t)wakePin);
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)wakePin, 0);
+  esp_sleep_enable_timer_wakeup(us);
+  Serial.flush();
+  esp_deep_sleep_start();
+}
+
+#endif
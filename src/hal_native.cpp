@@ -0,0 +1,669 @@
+#if !defined(ESP32)
+
+#include "hal.h"
+#include "hal_native.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <chrono>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Clock: milliseconds since the process started, like millis() since boot,
+// or virtual time for simulations
+
+typedef std::chrono::steady_clock Clock;
+
+static const Clock::time_point bootTime = Clock::now();
+static bool virtualClock = false;
+static uint64_t virtualUs = 0;
+static bool quiet = false;
+
+uint32_t halMillis() {
+  return (uint32_t)(halMicros() / 1000);
+}
+
+uint64_t halMicros() {
+  if (virtualClock) {
+    return virtualUs;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - bootTime).count();
+}
+
+void nativeUseVirtualClock() {
+  virtualClock = true;
+}
+
+void nativeAdvanceClock(uint32_t ms) {
+  virtualUs += (uint64_t)ms * 1000;
+}
+
+void nativeSetQuiet(bool on) {
+  quiet = on;
+}
+
+// GPIO and ADC: plain arrays driven through hal_native.h
+
+struct NativePin {
+  HalPinMode mode;
+  bool level;
+  uint16_t analog;
+  uint32_t pulses;
+  HalIsr isr;
+};
+
+static NativePin pins[nativePinCount];
+
+static NativePin* pinAt(int pin) {
+  return pin >= 0 && pin < nativePinCount ? &pins[pin] : nullptr;
+}
+
+void halPinMode(int pin, HalPinMode mode) {
+  if (NativePin* p = pinAt(pin)) {
+    p->mode = mode;
+    if (mode == HAL_INPUT_PULLUP) {
+      p->level = true;
+    }
+  }
+}
+
+void halDigitalWrite(int pin, bool high) {
+  if (NativePin* p = pinAt(pin)) {
+    p->level = high;
+  }
+}
+
+bool halDigitalRead(int pin) {
+  NativePin* p = pinAt(pin);
+  return p && p->level;
+}
+
+uint16_t halAnalogRead(int pin) {
+  NativePin* p = pinAt(pin);
+  return p ? p->analog : 0;
+}
+
+void halAttachFallingEdge(int pin, HalIsr isr) {
+  if (NativePin* p = pinAt(pin)) {
+    p->isr = isr;
+  }
+}
+
+void nativeSetAnalog(int pin, uint16_t value) {
+  if (NativePin* p = pinAt(pin)) {
+    p->analog = value;
+  }
+}
+
+void nativeSetDigital(int pin, bool high) {
+  NativePin* p = pinAt(pin);
+  if (!p) {
+    return;
+  }
+  bool falling = p->level && !high;
+  p->level = high;
+  if (falling && p->isr) {
+    p->isr();
+  }
+}
+
+void nativeAddPulses(int pin, uint32_t pulses) {
+  if (NativePin* p = pinAt(pin)) {
+    p->pulses += pulses;
+  }
+}
+
+uint32_t nativeTakePulses(int pin) {
+  NativePin* p = pinAt(pin);
+  if (!p) {
+    return 0;
+  }
+  uint32_t pulses = p->pulses;
+  p->pulses = 0;
+  return pulses;
+}
+
+// Display: printed to stdout whenever the visible frame changes
+
+static char displayLines[halDisplayRows][halDisplayColumns + 1];
+static bool backlightOn = false;
+
+static void printDisplay() {
+  if (quiet) {
+    return;
+  }
+  printf("[lcd%s] |%s|%s|\n", backlightOn ? "" : " dark", displayLines[0], displayLines[1]);
+  fflush(stdout);
+}
+
+void halDisplayBegin() {
+  for (int row = 0; row < halDisplayRows; row++) {
+    snprintf(displayLines[row], sizeof(displayLines[row]), "%-16s", "");
+  }
+  backlightOn = true;
+}
+
+void halDisplayLine(uint8_t row, const char* text) {
+  if (row >= halDisplayRows) {
+    return;
+  }
+  char line[halDisplayColumns + 1];
+  snprintf(line, sizeof(line), "%-16s", text);
+  if (strcmp(line, displayLines[row]) != 0) {
+    memcpy(displayLines[row], line, sizeof(line));
+    printDisplay();
+  }
+}
+
+void halDisplayBacklight(bool on) {
+  if (on != backlightOn) {
+    backlightOn = on;
+    printDisplay();
+  }
+}
+
+const char* nativeDisplayLine(int row) {
+  return row >= 0 && row < halDisplayRows ? displayLines[row] : "";
+}
+
+// Storage: "key value" lines in ./<namespace>.nvs, rewritten on every put
+// (commits are rare, the firmware batches them)
+
+static const int storageSlots = 32;
+static const int storageKeyLength = 16;   // NVS keys are at most 15 chars
+
+struct StorageEntry {
+  char key[storageKeyLength];
+  int64_t value;
+};
+
+static StorageEntry storage[storageSlots];
+static int storageCount = 0;
+static char storagePath[64];
+static bool memoryStorage = false;
+
+static StorageEntry* storageFind(const char* key, bool create) {
+  for (int i = 0; i < storageCount; i++) {
+    if (strcmp(storage[i].key, key) == 0) {
+      return &storage[i];
+    }
+  }
+  if (!create || storageCount == storageSlots) {
+    return nullptr;
+  }
+  StorageEntry* e = &storage[storageCount++];
+  snprintf(e->key, sizeof(e->key), "%s", key);
+  e->value = 0;
+  return e;
+}
+
+static void storagePut(const char* key, int64_t value) {
+  StorageEntry* e = storageFind(key, true);
+  if (!e) {
+    return;
+  }
+  e->value = value;
+  if (memoryStorage) {
+    return;
+  }
+
+  FILE* f = fopen(storagePath, "w");
+  if (!f) {
+    return;
+  }
+  for (int i = 0; i < storageCount; i++) {
+    fprintf(f, "%s %lld\n", storage[i].key, (long long)storage[i].value);
+  }
+  fclose(f);
+}
+
+void nativeUseMemoryStorage() {
+  memoryStorage = true;
+}
+
+void halStorageBegin(const char* ns) {
+  snprintf(storagePath, sizeof(storagePath), "%s.nvs", ns);
+  if (memoryStorage) {
+    return;
+  }
+  storageCount = 0;
+  FILE* f = fopen(storagePath, "r");
+  if (!f) {
+    return;
+  }
+  char key[storageKeyLength];
+  long long value;
+  while (storageCount < storageSlots && fscanf(f, "%15s %lld", key, &value) == 2) {
+    storageFind(key, true)->value = value;
+  }
+  fclose(f);
+}
+
+int32_t halStorageGetInt(const char* key, int32_t fallback) {
+  StorageEntry* e = storageFind(key, false);
+  return e ? (int32_t)e->value : fallback;
+}
+
+void halStoragePutInt(const char* key, int32_t value) {
+  storagePut(key, value);
+}
+
+uint32_t halStorageGetUInt(const char* key, uint32_t fallback) {
+  StorageEntry* e = storageFind(key, false);
+  return e ? (uint32_t)e->value : fallback;
+}
+
+void halStoragePutUInt(const char* key, uint32_t value) {
+  storagePut(key, value);
+}
+
+// Blobs: one ./<namespace>.<key>.bin file each, or a small table when the
+// storage is memory-only
+
+static const int blobSlots = 24;
+
+struct BlobEntry {
+  char key[storageKeyLength];
+  size_t length;
+  uint8_t data[halStorageBlobBytes];
+};
+
+static BlobEntry blobs[blobSlots];
+
+static BlobEntry* blobFind(const char* key, bool create) {
+  BlobEntry* free = nullptr;
+  for (int i = 0; i < blobSlots; i++) {
+    if (blobs[i].length && strcmp(blobs[i].key, key) == 0) {
+      return &blobs[i];
+    }
+    if (!blobs[i].length && !free) {
+      free = &blobs[i];
+    }
+  }
+  if (create && free) {
+    snprintf(free->key, sizeof(free->key), "%s", key);
+  }
+  return create ? free : nullptr;
+}
+
+static void blobPath(const char* key, char* path, size_t size) {
+  // storagePath is "<ns>.nvs"
+  snprintf(path, size, "%.*s.%s.bin", (int)(strlen(storagePath) - 4), storagePath, key);
+}
+
+size_t halStorageGetBytes(const char* key, void* out, size_t size) {
+  if (memoryStorage) {
+    BlobEntry* e = blobFind(key, false);
+    if (!e || e->length > size) {
+      return 0;
+    }
+    memcpy(out, e->data, e->length);
+    return e->length;
+  }
+  char path[96];
+  blobPath(key, path, sizeof(path));
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    return 0;
+  }
+  size_t length = fread(out, 1, size, f);
+  bool whole = fgetc(f) == EOF;
+  fclose(f);
+  return whole ? length : 0;
+}
+
+void halStoragePutBytes(const char* key, const void* data, size_t length) {
+  if (length == 0 || length > halStorageBlobBytes) {
+    return;
+  }
+  if (memoryStorage) {
+    if (BlobEntry* e = blobFind(key, true)) {
+      memcpy(e->data, data, length);
+      e->length = length;
+    }
+    return;
+  }
+  char path[96];
+  blobPath(key, path, sizeof(path));
+  FILE* f = fopen(path, "wb");
+  if (f) {
+    fwrite(data, 1, length, f);
+    fclose(f);
+  }
+}
+
+void halStorageRemove(const char* key) {
+  if (memoryStorage) {
+    if (BlobEntry* e = blobFind(key, false)) {
+      e->length = 0;
+    }
+    return;
+  }
+  char path[96];
+  blobPath(key, path, sizeof(path));
+  remove(path);
+}
+
+// HTTP: a non-blocking listening socket polled from the caller's loop. One
+// connection is served per poll and closed after the response, which is
+// all the dashboard and curl need. Privileged ports are shifted by 8000, so
+// the firmware's port 80 is 8080 here.
+
+static const int httpMaxRoutes = 24;
+static const size_t httpRequestBytes = 2048;
+static const int httpReadTimeoutMs = 200;
+
+struct HttpRoute {
+  const char* path;
+  HalHttpHandler handler;
+};
+
+static HttpRoute routes[httpMaxRoutes];
+static int routeCount = 0;
+static int listenFd = -1;
+static int clientFd = -1;
+static const char* query = nullptr;
+
+void halHttpBegin(uint16_t port) {
+  if (port < 1024) {
+    port += 8000;
+  }
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    return;
+  }
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 8) != 0) {
+    halPrintf("HTTP: cannot listen on port %u\n", port);
+    close(listenFd);
+    listenFd = -1;
+    return;
+  }
+  fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+  halPrintf("HTTP: listening on port %u\n", port);
+}
+
+void halHttpOn(const char* path, HalHttpHandler handler) {
+  if (routeCount < httpMaxRoutes) {
+    routes[routeCount].path = path;
+    routes[routeCount].handler = handler;
+    routeCount++;
+  }
+}
+
+static void writeAll(const char* data, size_t length) {
+  while (length > 0) {
+    ssize_t n = send(clientFd, data, length, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    length -= n;
+  }
+}
+
+static void writeHeader(int code, const char* type, const char* framing) {
+  char header[256];
+  int n = snprintf(header, sizeof(header),
+                   "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n%s\r\nConnection: close\r\n\r\n",
+                   code, code == 200 ? "OK" : code == 404 ? "Not Found" : "Error", type, framing);
+  writeAll(header, n);
+}
+
+// Reads until the end of the request line; the headers are not needed
+static bool readRequestLine(char* buffer, size_t size) {
+  timeval timeout = { 0, httpReadTimeoutMs * 1000 };
+  setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  size_t length = 0;
+  while (length + 1 < size) {
+    ssize_t n = recv(clientFd, buffer + length, size - 1 - length, 0);
+    if (n <= 0) {
+      return false;
+    }
+    length += n;
+    buffer[length] = '\0';
+    if (char* end = strstr(buffer, "\r\n")) {
+      *end = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+void halHttpPoll() {
+  if (listenFd < 0) {
+    return;
+  }
+  clientFd = accept(listenFd, nullptr, nullptr);
+  if (clientFd < 0) {
+    return;
+  }
+
+  char request[httpRequestBytes];
+  char* target = nullptr;
+  if (readRequestLine(request, sizeof(request)) && strncmp(request, "GET ", 4) == 0) {
+    target = request + 4;
+    if (char* version = strchr(target, ' ')) {
+      *version = '\0';
+    }
+  }
+
+  if (target) {
+    char* args = strchr(target, '?');
+    if (args) {
+      *args++ = '\0';
+    }
+    query = args ? args : "";
+
+    int i = 0;
+    while (i < routeCount && strcmp(routes[i].path, target) != 0) {
+      i++;
+    }
+    if (i < routeCount) {
+      routes[i].handler();
+    } else {
+      static const char notFound[] = "Not found";
+      halHttpSend(404, "text/plain", notFound, sizeof(notFound) - 1);
+    }
+  }
+
+  query = nullptr;
+  close(clientFd);
+  clientFd = -1;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool halHttpArg(const char* name, char* out, size_t size) {
+  size_t nameLength = strlen(name);
+  for (const char* p = query; p && *p; ) {
+    const char* end = strchr(p, '&');
+    if (!end) {
+      end = p + strlen(p);
+    }
+    if (strncmp(p, name, nameLength) == 0 && (p[nameLength] == '=' || p + nameLength == end)) {
+      const char* v = p[nameLength] == '=' ? p + nameLength + 1 : end;
+      size_t n = 0;
+      for (; v < end && n + 1 < size; v++) {
+        if (*v == '%' && end - v > 2 && hexValue(v[1]) >= 0 && hexValue(v[2]) >= 0) {
+          out[n++] = (char)(hexValue(v[1]) * 16 + hexValue(v[2]));
+          v += 2;
+        } else {
+          out[n++] = *v == '+' ? ' ' : *v;
+        }
+      }
+      if (size) {
+        out[n] = '\0';
+      }
+      return true;
+    }
+    p = *end ? end + 1 : end;
+  }
+  return false;
+}
+
+void halHttpSend(int code, const char* type, const char* body, size_t length) {
+  char framing[48];
+  snprintf(framing, sizeof(framing), "Content-Length: %u", (unsigned)length);
+  writeHeader(code, type, framing);
+  writeAll(body, length);
+}
+
+void halHttpBeginChunked(const char* type) {
+  writeHeader(200, type, "Transfer-Encoding: chunked");
+}
+
+void halHttpSendChunk(const char* data, size_t length) {
+  if (length == 0) {
+    return;
+  }
+  char size[16];
+  int n = snprintf(size, sizeof(size), "%x\r\n", (unsigned)length);
+  writeAll(size, n);
+  writeAll(data, length);
+  writeAll("\r\n", 2);
+}
+
+void halHttpEndChunked() {
+  writeAll("0\r\n\r\n", 5);
+}
+
+// Console and heap
+
+// TCP client: blocking connect with a timeout, then writes block and
+// reads don't
+
+static int tcpFd = -1;
+
+bool halTcpLinkUp() {
+  return true;
+}
+
+bool halTcpConnect(const char* host, uint16_t port, uint32_t timeoutMs) {
+  halTcpClose();
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* found = nullptr;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &found) != 0) {
+    return false;
+  }
+
+  tcpFd = socket(AF_INET, SOCK_STREAM, 0);
+  int flags = fcntl(tcpFd, F_GETFL, 0);
+  fcntl(tcpFd, F_SETFL, flags | O_NONBLOCK);
+  int rc = connect(tcpFd, found->ai_addr, found->ai_addrlen);
+  freeaddrinfo(found);
+  if (rc != 0 && errno == EINPROGRESS) {
+    pollfd p = { tcpFd, POLLOUT, 0 };
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&p, 1, timeoutMs) == 1 &&
+        getsockopt(tcpFd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+      rc = 0;
+    }
+  }
+  if (rc != 0) {
+    halTcpClose();
+    return false;
+  }
+  fcntl(tcpFd, F_SETFL, flags);
+  int yes = 1;
+  setsockopt(tcpFd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+  return true;
+}
+
+bool halTcpWrite(const uint8_t* data, size_t length) {
+  while (tcpFd >= 0 && length > 0) {
+    ssize_t n = send(tcpFd, data, length, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return tcpFd >= 0;
+}
+
+int halTcpRead(uint8_t* out, size_t size) {
+  if (tcpFd < 0) {
+    return -1;
+  }
+  ssize_t n = recv(tcpFd, out, size, MSG_DONTWAIT);
+  if (n > 0) {
+    return (int)n;
+  }
+  return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+}
+
+void halTcpClose() {
+  if (tcpFd >= 0) {
+    close(tcpFd);
+    tcpFd = -1;
+  }
+}
+
+void halPrintf(const char* format, ...) {
+  if (quiet) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  fflush(stdout);
+}
+
+// A host has no fixed heap to watch, so heap deltas read as zero
+uint32_t halFreeHeap() {
+  return 0;
+}
+
+uint32_t halLargestFreeBlock() {
+  return 0;
+}
+
+HalWakeCause halLightSleep(uint64_t us) {
+  return HAL_WAKE_NONE;
+}
+
+uint64_t halRtcMicros() {
+  return halMicros();
+}
+
+HalWakeCause halDeepSleepWakeCause() {
+  return HAL_WAKE_NONE;
+}
+
+void halHoldOutput(int pin, bool hold) {}
+
+void halDeepSleep(uint64_t us, int wakePin) {
+  halPrintf("deep sleep for %llu ms, exiting\n", (unsigned long long)(us / 1000));
+  exit(0);
+}
+
+#endif
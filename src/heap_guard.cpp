@@ -0,0 +1,121 @@
+#include "heap_guard.h"
+
+#include "hal.h"
+#include "task_manager.h"
+
+#if defined(ESP32)
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#endif
+
+#ifdef HEAP_GUARD
+
+static const int recentCallers = 8;
+
+static volatile bool armed = false;
+// One counter per task plus one for everything else (WiFi, lwIP, timers)
+static uint32_t allocations[TASK_COUNT + 1];
+static void* callers[recentCallers];
+static uint32_t callerCount = 0;
+
+static void noteAllocation(void* caller) {
+  if (!armed) {
+    return;
+  }
+
+  TaskHandle_t current = xTaskGetCurrentTaskHandle();
+  int owner = TASK_COUNT;
+  for (int i = 0; i < TASK_COUNT; i++) {
+    if (taskHandle((TaskId)i) == current) {
+      owner = i;
+      break;
+    }
+  }
+  __atomic_fetch_add(&allocations[owner], 1, __ATOMIC_RELAXED);
+  uint32_t n = __atomic_fetch_add(&callerCount, 1, __ATOMIC_RELAXED);
+  callers[n % recentCallers] = caller;
+
+#ifdef HEAP_GUARD_STRICT
+  if (owner == TASK_CONTROL || owner == TASK_UI) {
+    // ets_printf doesn't allocate
+    ets_printf("heap guard: allocation from %s task, caller %p\n",
+               taskStats((TaskId)owner).name, caller);
+    abort();
+  }
+#endif
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  noteAllocation(__builtin_return_address(0));
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  noteAllocation(__builtin_return_address(0));
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  noteAllocation(__builtin_return_address(0));
+  return __real_realloc(ptr, size);
+}
+}
+
+void heapGuardArm() {
+  armed = true;
+}
+
+bool heapGuardEnabled() {
+  return true;
+}
+
+uint32_t heapGuardAllocations(TaskId task) {
+  return __atomic_load_n(&allocations[task], __ATOMIC_RELAXED);
+}
+
+#else
+
+void heapGuardArm() {}
+
+bool heapGuardEnabled() {
+  return false;
+}
+
+uint32_t heapGuardAllocations(TaskId task) {
+  return 0;
+}
+
+#endif
+
+void heapGuardJson(TextBuffer& out) {
+#if defined(ESP32)
+  out.appendf("{\"free\":%u,\"minFree\":%u,\"largestBlock\":%u,\"guard\":%s",
+              (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+              (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+              (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+              heapGuardEnabled() ? "true" : "false");
+#else
+  out.appendf("{\"free\":%u,\"guard\":%s", (unsigned)halFreeHeap(),
+              heapGuardEnabled() ? "true" : "false");
+#endif
+#ifdef HEAP_GUARD
+  out.append(",\"allocationsAfterBoot\":{");
+  for (int i = 0; i <= TASK_COUNT; i++) {
+    out.appendf("%s\"%s\":%u", i ? "," : "",
+                i < TASK_COUNT ? taskStats((TaskId)i).name : "other",
+                (unsigned)allocations[i]);
+  }
+  out.append("},\"recentCallers\":[");
+  uint32_t n = callerCount < recentCallers ? callerCount : recentCallers;
+  for (uint32_t i = 0; i < n; i++) {
+    out.appendf("%s\"%p\"", i ? "," : "", callers[(callerCount - 1 - i) % recentCallers]);
+  }
+  out.append("]");
+#endif
+  out.append("}");
+}
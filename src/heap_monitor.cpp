@@ -0,0 +1,135 @@
+#include "heap_monitor.h"
+
+#include <string.h>
+
+#include "hal.h"
+
+HeapMonitor::HeapMonitor() : head_(0) {
+  memset(trend_, 0, sizeof(trend_));
+  memset(&state_, 0, sizeof(state_));
+}
+
+uint8_t HeapMonitor::sample(uint32_t nowSeconds) {
+  HeapTrendEntry& e = trend_[head_ % trendSize];
+  e.timeS = nowSeconds;
+  e.freeBytes = halFreeHeap();
+  e.largestBlock = halLargestFreeBlock();
+  e.fragmentationPermille =
+      e.freeBytes ? (uint16_t)(1000 - (uint64_t)e.largestBlock * 1000 / e.freeBytes) : 0;
+
+  bool stacksKnown = true;
+  for (int i = 0; i < TASK_COUNT; i++) {
+    uint32_t bytes = 0;
+    stacksKnown &= taskStackFree((TaskId)i, bytes);
+    e.stackFree[i] = bytes > UINT16_MAX ? UINT16_MAX : (uint16_t)bytes;
+  }
+  published_[head_ % trendSize].write(e);
+  head_++;
+
+  if (state_.samples == 0 || e.freeBytes < state_.minFreeBytes) {
+    state_.minFreeBytes = e.freeBytes;
+  }
+  if (state_.samples == 0 || e.largestBlock < state_.minLargestBlock) {
+    state_.minLargestBlock = e.largestBlock;
+  }
+  state_.latest = e;
+  state_.samples++;
+  state_.blockSlopePerHour = blockSlopePerHour();
+
+  uint8_t warnings = 0;
+  if (e.freeBytes) {
+    if (e.largestBlock < warnBlockBytes) {
+      warnings |= HEAP_WARN_LOW_BLOCK;
+    }
+    if (e.fragmentationPermille >= warnFragmentationPermille) {
+      warnings |= HEAP_WARN_FRAGMENTED;
+    }
+    int32_t slope = state_.blockSlopePerHour;
+    if (slope < 0 && e.largestBlock > criticalBlockBytes &&
+        (e.largestBlock - criticalBlockBytes) / (uint32_t)-slope < warnHorizonHours) {
+      warnings |= HEAP_WARN_SHRINKING;
+    }
+  }
+  if (stacksKnown) {
+    for (int i = 0; i < TASK_COUNT; i++) {
+      if (e.stackFree[i] < warnStackBytes) {
+        warnings |= HEAP_WARN_STACK;
+      }
+    }
+  }
+
+  uint8_t raised = warnings & ~state_.warnings;
+  state_.warnings = warnings;
+  health_.write(state_);
+  return raised;
+}
+
+// Least-squares slope of the largest block against time over the ring.
+// Needs a few points, a single noisy minute shouldn't trigger a warning.
+int32_t HeapMonitor::blockSlopePerHour() const {
+  static const uint32_t minPoints = 8;
+  uint32_t n = head_ < (uint32_t)trendSize ? head_ : trendSize;
+  if (n < minPoints) {
+    return 0;
+  }
+
+  uint32_t t0 = trend_[(head_ - n) % trendSize].timeS;
+  float sumT = 0, sumB = 0, sumTT = 0, sumTB = 0;
+  for (uint32_t i = head_ - n; i != head_; i++) {
+    const HeapTrendEntry& e = trend_[i % trendSize];
+    float t = (float)(e.timeS - t0) / 3600;
+    float b = (float)e.largestBlock;
+    sumT += t;
+    sumB += b;
+    sumTT += t * t;
+    sumTB += t * b;
+  }
+  float denominator = n * sumTT - sumT * sumT;
+  if (denominator <= 0) {
+    return 0;
+  }
+  return (int32_t)((n * sumTB - sumT * sumB) / denominator);
+}
+
+const char* HeapMonitor::warningText(uint8_t warnings) {
+  if (warnings & HEAP_WARN_LOW_BLOCK) return "Heap block low";
+  if (warnings & HEAP_WARN_SHRINKING) return "Heap shrinking";
+  if (warnings & HEAP_WARN_FRAGMENTED) return "Heap fragmented";
+  if (warnings & HEAP_WARN_STACK) return "Stack low";
+  return nullptr;
+}
+
+void HeapMonitor::json(TextBuffer& out) const {
+  static const char* warningNames[] = { "lowBlock", "fragmented", "shrinking", "stack" };
+  HeapHealth h = health();
+
+  out.appendf("{\"samples\":%u,\"free\":%u,\"largestBlock\":%u,\"fragmentationPermille\":%u,"
+              "\"minFree\":%u,\"minLargestBlock\":%u,\"blockSlopePerHour\":%d,\"warnings\":[",
+              (unsigned)h.samples, (unsigned)h.latest.freeBytes, (unsigned)h.latest.largestBlock,
+              h.latest.fragmentationPermille, (unsigned)h.minFreeBytes,
+              (unsigned)h.minLargestBlock, (int)h.blockSlopePerHour);
+  int n = 0;
+  for (int bit = 0; bit < 4; bit++) {
+    if (h.warnings & (1 << bit)) {
+      out.appendf("%s\"%s\"", n++ ? "," : "", warningNames[bit]);
+    }
+  }
+  out.append("],\"stackFree\":{");
+  for (int i = 0; i < TASK_COUNT; i++) {
+    out.appendf("%s\"%s\":%u", i ? "," : "", taskStats((TaskId)i).name, h.latest.stackFree[i]);
+  }
+
+  // [time, free, largestBlock, fragmentationPermille, stack free per task...]
+  out.append("},\"trend\":[");
+  uint32_t count = h.samples < (uint32_t)trendSize ? h.samples : trendSize;
+  for (uint32_t i = h.samples - count; i != h.samples; i++) {
+    HeapTrendEntry e = published_[i % trendSize].read();
+    out.appendf("%s[%u,%u,%u,%u", i != h.samples - count ? "," : "", (unsigned)e.timeS,
+                (unsigned)e.freeBytes, (unsigned)e.largestBlock, e.fragmentationPermille);
+    for (int t = 0; t < TASK_COUNT; t++) {
+      out.appendf(",%u", e.stackFree[t]);
+    }
+    out.append("]");
+  }
+  out.append("]}");
+}
@@ -0,0 +1,100 @@
+#include "latency_histogram.h"
+
+#include "hal.h"
+
+static LatencyHistogram histograms[LAT_SECTION_COUNT] = {
+  LatencyHistogram("network"),
+  LatencyHistogram("control"),
+  LatencyHistogram("ui"),
+  LatencyHistogram("handleClient"),
+  LatencyHistogram("sampling"),
+  LatencyHistogram("irrigation"),
+  LatencyHistogram("menu"),
+  LatencyHistogram("display"),
+  LatencyHistogram("pref"),
+};
+
+LatencyHistogram::LatencyHistogram(const char* name) : name_(name) {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  for (int i = 0; i < bucketCount; i++) {
+    buckets_[i] = 0;
+  }
+  count_ = 0;
+  max_ = 0;
+}
+
+uint32_t LatencyHistogram::upperBound(int bucket) {
+  if (bucket < (1 << subBits)) {
+    return bucket;
+  }
+  int msb = (bucket >> subBits) - 1 + subBits;
+  uint32_t sub = bucket & ((1 << subBits) - 1);
+  uint32_t lower = (1u << msb) | (sub << (msb - subBits));
+  return lower + ((1u << (msb - subBits)) - 1);
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t permille) const {
+  uint32_t total = count_;
+  if (total == 0) {
+    return 0;
+  }
+  uint32_t target = (uint32_t)(((uint64_t)total * permille + 999) / 1000);
+  uint32_t seen = 0;
+  for (int i = 0; i < bucketCount; i++) {
+    seen += buckets_[i];
+    if (seen >= target) {
+      uint32_t bound = upperBound(i);
+      return bound < max_ ? bound : max_;
+    }
+  }
+  return max_;
+}
+
+LatencyHistogram& latency(LatencySection section) {
+  return histograms[section];
+}
+
+// Microseconds with one decimal
+static void splitMicros(uint32_t cycles, uint32_t cpm, unsigned& whole, unsigned& tenths) {
+  uint32_t t = (uint32_t)((uint64_t)cycles * 10 / cpm);
+  whole = t / 10;
+  tenths = t % 10;
+}
+
+void latencyJson(TextBuffer& out) {
+  uint32_t cpm = cyclesPerMicrosecond();
+  out.appendf("{\"cpuMhz\":%u,\"sections\":[", (unsigned)cpm);
+  for (int i = 0; i < LAT_SECTION_COUNT; i++) {
+    const LatencyHistogram& h = histograms[i];
+    unsigned p50, p50t, p99, p99t, mx, mxt;
+    splitMicros(h.percentile(500), cpm, p50, p50t);
+    splitMicros(h.percentile(990), cpm, p99, p99t);
+    splitMicros(h.max(), cpm, mx, mxt);
+    out.appendf("%s{\"name\":\"%s\",\"count\":%u,\"p50Us\":%u.%u,\"p99Us\":%u.%u,\"maxUs\":%u.%u}",
+                i ? "," : "", h.name(), (unsigned)h.count(), p50, p50t, p99, p99t, mx, mxt);
+  }
+  out.append("]}");
+}
+
+void latencyReport() {
+  uint32_t cpm = cyclesPerMicrosecond();
+  halPrintf("%-13s %10s %10s %10s %12s\n", "section", "count", "p50 us", "p99 us", "max us");
+  for (int i = 0; i < LAT_SECTION_COUNT; i++) {
+    const LatencyHistogram& h = histograms[i];
+    unsigned p50, p50t, p99, p99t, mx, mxt;
+    splitMicros(h.percentile(500), cpm, p50, p50t);
+    splitMicros(h.percentile(990), cpm, p99, p99t);
+    splitMicros(h.max(), cpm, mx, mxt);
+    halPrintf("%-13s %10u %8u.%u %8u.%u %10u.%u\n", h.name(), (unsigned)h.count(),
+                  p50, p50t, p99, p99t, mx, mxt);
+  }
+}
+
+void latencyReset() {
+  for (int i = 0; i < LAT_SECTION_COUNT; i++) {
+    histograms[i].reset();
+  }
+}
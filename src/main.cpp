@@ -1,26 +1,15 @@
-#include <WiFi.h>
-#include <WebServer.h>
-#include <LiquidCrystal_I2C.h>
-#include <Preferences.h>
-
-
-
-Preferences pref;
-
-// Pin Definitions
-#define MOISTURE_SENSOR_PIN 34
-#define RELAY_PIN 14
-#define BUZZER_PIN 25
+#if defined(ESP32)
 
-#define MENU_BUTTON_PIN 32
-#define PLUS_BUTTON_PIN 33
-#define MINUS_BUTTON_PIN 35
-
-
-#define RW_MODE false
-#define RO_MODE true 
-
-const char* thresh = "threshold";
+#include <WiFi.h>
+#include <esp_freertos_hooks.h>
+#include "boot_profile.h"
+#include "controller.h"
+#include "field_mode.h"
+#include "hal.h"
+#include "heap_guard.h"
+#include "power.h"
+#include "task_manager.h"
+#include "telemetry.h"
 
 // WiFi Hotspot Configuration
 const char* ssid = "SmartIrrigation";
@@ -31,357 +20,267 @@ IPAddress local_IP(192, 168, 4, 1);
 IPAddress gateway(192, 168, 4, 1);
 IPAddress subnet(255, 255, 255, 0);
 
-// Web Server
-WebServer server(80);
-
-//define functions
-void setupServer();
-void handleMenu(int moisturePercentage);
-void processIrrigation(int moisturePercentage);
-
-
-
-// LCD Configuration
-LiquidCrystal_I2C lcd(0x27, 16, 2);
-
-// Global Variables
-int moistureThreshold =pref.isKey(thresh)?pref.getInt(thresh): 40;  // Default threshold
-int currentMoisture = 0;
-bool menuActive = false;
-bool systemMode = false;  // false = manual, true = WiFi
-
-// Button State Tracking
-int lastMenuButtonState = HIGH;
-int lastPlusButtonState = HIGH;
-int lastMinusButtonState = HIGH;
-
-
-// Timing Variables
-unsigned long lastDebounceTime = 0;
-const unsigned long debounceDelay = 50;
-unsigned long lastMoistureCheckTime = 0;
-const unsigned long moistureCheckInterval = 1000;
-unsigned long lastThresholdAdjustTime = 0;
-const unsigned long thresholdAdjustInterval = 200;
-
-// HTML Page
-const char* htmlPage = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>Smart Irrigation System</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body {
-            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
-            margin: 0;
-            padding: 0;
-            background-color: #f0f4f8;
-            display: flex;
-            justify-content: center;
-            align-items: center;
-            min-height: 100vh;
-        }
-        .container {
-            background-color: white;
-            border-radius: 15px;
-            box-shadow: 0 10px 25px rgba(0,0,0,0.1);
-            padding: 30px;
-            width: 90%;
-            max-width: 500px;
-            text-align: center;
-        }
-        h1 {
-            color: #2c3e50;
-            margin-bottom: 20px;
-        }
-        .status-card {
-            background-color: #ecf0f1;
-            border-radius: 10px;
-            padding: 15px;
-            margin-bottom: 20px;
-        }
-        .status-label {
-            font-weight: bold;
-            color: #34495e;
-        }
-        .threshold-control {
-            display: flex;
-            align-items: center;
-            justify-content: space-between;
-            margin-bottom: 20px;
-        }
-        input[type="range"] {
-            flex-grow: 1;
-            margin: 0 15px;
-        }
-        .btn {
-            background-color: #3498db;
-            color: white;
-            border: none;
-            padding: 10px 20px;
-            border-radius: 5px;
-            cursor: pointer;
-            transition: background-color 0.3s ease;
-        }
-        .btn:hover {
-            background-color: #2980b9;
-        }
-        #modeToggle {
-            background-color: #2ecc71;
-        }
-        #modeToggle:hover {
-            background-color: #27ae60;
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>Smart Irrigation System</h1>
-        <div class="status-card">
-            <p><span class="status-label">Soil Moisture:</span> <span id="moisture">0%</span></p>
-            <p><span class="status-label">System Status:</span> <span id="systemStatus">Idle</span></p>
-        </div>
-        <div class="threshold-control">
-            <span>Moisture Threshold:</span>
-            <span id="threshold">40</span>%
-            <input type="range" id="thresholdSlider" min="0" max="100" value="40" onchange="updateThreshold(this.value)">
-        </div>
-        <div>
-            <button class="btn" onclick="changeThreshold('decrease')">-</button>
-            <button class="btn" onclick="changeThreshold('increase')">+</button>
-            <button id="modeToggle" class="btn" onclick="toggleMode()">Toggle Mode</button>
-        </div>
-    </div>
-
-    <script>
-        async function updatePage() {
-            const response = await fetch('/status');
-            const data = await response.json();
-            document.getElementById('moisture').textContent = data.moisture + '%';
-            document.getElementById('threshold').textContent = data.threshold + '%';
-            document.getElementById('thresholdSlider').value = data.threshold;
-            document.getElementById('systemStatus').textContent = data.status;
-        }
-
-        async function changeThreshold(action) {
-            await fetch('/threshold?action=' + action);
-            updatePage();
-        }
-
-        async function updateThreshold(value) {
-            await fetch('/threshold?value=' + value);
-            updatePage();
-        }
-
-        async function toggleMode() {
-            await fetch('/toggle-mode');
-            updatePage();
-        }
-
-        setInterval(updatePage, 2000);
-        updatePage();
-    </script>
-</body>
-</html>
-)rawliteral";
-
-void setup() {
-  Serial.begin(115200);
-
-  // Initialize Pins
-  pinMode(MOISTURE_SENSOR_PIN, INPUT);
-  pinMode(RELAY_PIN, OUTPUT);
-  pinMode(BUZZER_PIN, OUTPUT);
-  pinMode(MENU_BUTTON_PIN, INPUT_PULLUP);
-  pinMode(PLUS_BUTTON_PIN, INPUT_PULLUP);
-  pinMode(MINUS_BUTTON_PIN, INPUT_PULLUP);
-
-  // init pref
-
-  pref.begin("pref", false);
+// Station mode joins the site network for MQTT (and serves the same web UI
+// there). -DWIFI_STA_ONLY leaves the access point down until requested.
+#if defined(WIFI_STA_SSID)
+#ifndef WIFI_STA_PASSWORD
+#define WIFI_STA_PASSWORD ""
+#endif
+const bool stationEnabled = true;
+#else
+#if defined(WIFI_STA_ONLY)
+#error "WIFI_STA_ONLY needs WIFI_STA_SSID"
+#endif
+const bool stationEnabled = false;
+#endif
+
+// Telemetry broker; without MQTT_BROKER nothing is published
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+#ifndef MQTT_CLIENT_ID
+#define MQTT_CLIENT_ID "irrigation"
+#endif
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX "irrigation/" MQTT_CLIENT_ID
+#endif
+#ifndef MQTT_INTERVAL_S
+#define MQTT_INTERVAL_S 60
+#endif
+#ifndef MQTT_QOS
+#define MQTT_QOS 1
+#endif
+#if defined(MQTT_BROKER)
+#if !defined(WIFI_STA_SSID)
+#error "MQTT_BROKER needs WIFI_STA_SSID"
+#endif
+const char* mqttBroker = MQTT_BROKER;
+#else
+const char* mqttBroker = nullptr;
+#endif
+
+void networkTask(void* arg);
+void controlTask(void* arg);
+void uiTask(void* arg);
+
+void wakeUiTask(void* arg) {
+  TaskHandle_t ui = taskHandle(TASK_UI);
+  if (!ui) {
+    return;
+  }
+  if (xPortInIsrContext()) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(ui, &woken);
+    portYIELD_FROM_ISR(woken);
+  } else {
+    xTaskNotifyGive(ui);
+  }
+}
 
-  // Initialize LCD
-  lcd.init();
-  lcd.backlight();
-  lcd.print("Smart Irrigation");
-  delay(2000);
-  lcd.clear();
+// Lifecycle checks only need to be as fine as the idle timeouts
+const uint32_t apPollInterval = 1000;
+// With the radio down there is no one to serve; only the history and
+// telemetry feeds run
+const uint32_t radioOffPollInterval = 100;
 
-  // Setup WiFi Access Point
+void startAccessPoint() {
+  WiFi.mode(stationEnabled ? WIFI_AP_STA : WIFI_AP);
   WiFi.softAP(ssid, password);
   WiFi.softAPConfig(local_IP, gateway, subnet);
+  powerHold(POWER_HOLD_RADIO, true);
+  accessPoint.started(halMillis());
 
   Serial.println("Access Point Started");
   Serial.print("IP Address: ");
   Serial.println(WiFi.softAPIP());
-  digitalWrite(RELAY_PIN, LOW);
-  digitalWrite(BUZZER_PIN, LOW);
-
-  setupServer();
-  Serial.println("HTTP server started");
 }
 
+// The station, when configured, stays up (and keeps the radio hold)
+void stopAccessPoint() {
+  WiFi.softAPdisconnect(true);
+  WiFi.mode(stationEnabled ? WIFI_STA : WIFI_OFF);
+  uint32_t now = halMillis();
+  accessPoint.stopped(now);
+  powerHold(POWER_HOLD_RADIO, stationEnabled);
+  Serial.printf("Access Point stopped after idle, radio on %u s of %u s\n",
+                (unsigned)(accessPoint.radioOnMs(now) / 1000), (unsigned)(now / 1000));
+}
 
-void setupServer (){
-  // Web Server Routes
-  server.on("/", HTTP_GET, []() {
-    server.send(200, "text/html", htmlPage);
-  });
-
-  server.on("/status", HTTP_GET, []() {
-    currentMoisture = analogRead(MOISTURE_SENSOR_PIN);
-    int moisturePercentage =100- map(currentMoisture, 0, 4095, 0, 100);
-    
-    String status;
-    if (systemMode) {
-      // WiFi mode
-      status = (moisturePercentage < moistureThreshold) ? "Irrigating (WiFi)" : "Idle (WiFi)";
-      digitalWrite(RELAY_PIN, (moisturePercentage < moistureThreshold) ? HIGH : LOW);
-    } else {
-      // Manual mode
-      status = (moisturePercentage < moistureThreshold) ? "Irrigating (Manual)" : "Idle (Manual)";
-      // Manual mode control stays in the loop() function
-    }
-
-    // Critical moisture alert
-    digitalWrite(BUZZER_PIN, (moisturePercentage < 20) ? HIGH : LOW);
+#if defined(WIFI_STA_SSID)
+// Reconnects on its own after the AP drops or the router restarts
+void startStation() {
+  if (!accessPoint.on()) {
+    WiFi.mode(WIFI_STA);
+  }
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(WIFI_STA_SSID, WIFI_STA_PASSWORD);
+  powerHold(POWER_HOLD_RADIO, true);
+  Serial.println("Joining " WIFI_STA_SSID);
+}
+#endif
+
+void startRadio() {
+#if !defined(WIFI_STA_ONLY)
+  startAccessPoint();
+#endif
+#if defined(WIFI_STA_SSID)
+  startStation();
+#endif
+  bootMark(BOOT_NETWORK);
+}
 
-    String json = "{";
-    json += "\"moisture\":" + String(moisturePercentage) + ",";
-    json += "\"threshold\":" + String(moistureThreshold) + ",";
-    json += "\"status\":\"" + status + "\"";
-    json += "}";
+void beginTelemetry() {
+  TelemetryConfig config;
+  config.host = mqttBroker;
+  config.port = MQTT_PORT;
+  config.clientId = MQTT_CLIENT_ID;
+  config.topicPrefix = MQTT_TOPIC_PREFIX;
+  config.intervalMs = MQTT_INTERVAL_S * 1000UL;
+  config.qos = MQTT_QOS;
+  telemetryBegin(config);
+}
 
-    server.send(200, "application/json", json);
-  });
+void pollAccessPoint() {
+  static uint32_t lastPollMs = 0;
+  uint32_t now = halMillis();
+  if (now - lastPollMs < apPollInterval) {
+    return;
+  }
+  lastPollMs = now;
+  int stations = accessPoint.on() ? WiFi.softAPgetStationNum() : 0;
+  switch (accessPoint.poll(now, stations, httpLastRequestMs())) {
+    case AP_START:
+      startAccessPoint();
+      break;
+    case AP_STOP:
+      stopAccessPoint();
+      break;
+    case AP_NONE:
+      break;
+  }
+}
 
-  server.on("/threshold", HTTP_GET, []() {
-    if (server.hasArg("action")) {
-      String action = server.arg("action");
-      if (action == "increase") {
-        moistureThreshold = min(moistureThreshold + 1, 100);
+// Core 1 idle: control and UI are both blocked. Light sleep stops the
+// FreeRTOS tick, so their queue/notify timeouts are cut short afterwards;
+// both re-read halMillis() and block again for whatever remains.
+bool idleSleep() {
+  if (powerIdle()) {
+    xTaskAbortDelay(taskHandle(TASK_CONTROL));
+    xTaskAbortDelay(taskHandle(TASK_UI));
+  }
+  return true;
+}
 
-      } else if (action == "decrease") {
-        moistureThreshold = max(moistureThreshold - 1, 0);
-      }
-    } else if (server.hasArg("value")) {
-      moistureThreshold = server.arg("value").toInt();
+#if defined(FAST_BOOT)
+// The LCD (UI task) and WiFi/HTTP (network task) come up in parallel after
+// the control task; whichever finishes last ends the boot allocations
+static uint32_t backgroundInitsLeft = 2;
 
-    }
-    pref.putInt(thresh, moistureThreshold);
-    pref.end();
-    server.send(200, "text/plain", "Threshold updated");
-  });
+void backgroundInitDone() {
+  if (__atomic_sub_fetch(&backgroundInitsLeft, 1, __ATOMIC_ACQ_REL) == 0) {
+    heapGuardArm();
+  }
+}
+#endif
 
-  server.on("/toggle-mode", HTTP_GET, []() {
-    systemMode = !systemMode;
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(systemMode ? "WiFi Mode" : "Manual Mode");
-    delay(1500);
-    server.send(200, "text/plain", "Mode toggled");
-  });
+void setup() {
+  Serial.begin(115200);
+  bootMark(BOOT_SETUP);
+
+#if defined(FIELD_MODE)
+  // Most wakes end here, back in deep sleep after one sample; the rest
+  // boot the full firmware for a web window, carrying on from the cycle
+  const FieldState& field = fieldState();
+  if (fieldCycle(halDeepSleepWakeCause()) == FIELD_SLEEP) {
+    fieldSleep(field.relayOn, field.threshold);
+  }
+  ControllerResume fieldResume = { field.relayOn, (int)field.threshold };
+  const ControllerResume* resume = &fieldResume;
+#else
+  const ControllerResume* resume = nullptr;
+#endif
+
+#if defined(FAST_BOOT)
+  // Relay safety state and sampling first; nothing below blocks on I2C or
+  // the radio
+  controllerBeginControl(resume);
+  beginTelemetry();
+  uiCoroutines.setWakeHook(wakeUiTask, nullptr);
+  startTask(TASK_CONTROL, controlTask);
+  startTask(TASK_UI, uiTask);
+  startTask(TASK_NETWORK, networkTask);
+  esp_register_freertos_idle_hook_for_cpu(idleSleep, 1);
+#else
+  controllerBegin(resume);
+  beginTelemetry();
+  uiCoroutines.setWakeHook(wakeUiTask, nullptr);
+
+  startRadio();
+  setupServer();
+  Serial.println("HTTP server started");
 
-  // Start Server
-  server.begin();
+  startTask(TASK_CONTROL, controlTask);
+  startTask(TASK_UI, uiTask);
+  startTask(TASK_NETWORK, networkTask);
+  esp_register_freertos_idle_hook_for_cpu(idleSleep, 1);
 
+  // Boot is done; from here on the heap should stay untouched
+  heapGuardArm();
+#endif
 }
 
 void loop() {
-  // Handle web server requests
-  server.handleClient();
-
-  unsigned long currentTime = millis();
-
-  if (currentTime - lastMoistureCheckTime >= moistureCheckInterval) {
-    currentMoisture = analogRead(MOISTURE_SENSOR_PIN);
-    int moisturePercentage =100- map(currentMoisture, 0, 4095, 0, 100);
-    
-    // Handle menu first
-    handleMenu(moisturePercentage);
-
-    // Only process moisture if not in menu mode
-    if (!menuActive) {
-      processIrrigation(moisturePercentage);
-    }
-
-    lastMoistureCheckTime = currentTime;
-  }
-  pref.end();
+  // All work happens in the pinned tasks started from setup()
+  vTaskDelete(NULL);
 }
-void processIrrigation(int moisturePercentage) {
-  // Update LCD with current status
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Moisture: ");
-  lcd.print(moisturePercentage);
-  lcd.print("%");
 
-  // Control relay based on moisture and system mode
-  if (!systemMode) {
-    lcd.setCursor(0, 0);
-    lcd.print("Status:");
-    if (moisturePercentage < moistureThreshold) {
-      digitalWrite(RELAY_PIN, HIGH); // Turn on 
-      
-      lcd.setCursor(0, 1);
-      lcd.print("Irrigating");
-    } else {
-      digitalWrite(RELAY_PIN, LOW); // Turn off relay
-      lcd.setCursor(0, 1);
-      lcd.print("Idle");
+// Core 0: HTTP and MQTT. handleClient() returns immediately when idle, the
+// 1 ms delay keeps the idle task (and its watchdog) fed. With no one able to
+// reach the web UI it only feeds the history and telemetry and waits for a
+// request to raise the access point.
+void networkTask(void* arg) {
+#if defined(FAST_BOOT)
+  startRadio();
+  setupServer();
+  Serial.println("HTTP server started");
+  backgroundInitDone();
+#endif
+  for (;;) {
+    pollAccessPoint();
+#if defined(FIELD_MODE)
+    if (fieldWebWindowOver() || (!accessPoint.on() && !stationEnabled)) {
+      ControllerSnapshot snap = controller.snapshot();
+      fieldSleep(snap.relayOn, snap.threshold);
     }
-  }
-
-  // Critical moisture alert
-  if (moisturePercentage < 20) {
-    digitalWrite(BUZZER_PIN, HIGH);
-  } else {
-    digitalWrite(BUZZER_PIN, LOW);
+#endif
+    networkPoll();
+    bool reachable = accessPoint.on() || halTcpLinkUp();
+    vTaskDelay(reachable ? 1 : pdMS_TO_TICKS(radioOffPollInterval));
   }
 }
 
-void handleMenu(int moisturePercentage) {
-  int menuButtonState = digitalRead(MENU_BUTTON_PIN);
-  int plusButtonState = digitalRead(PLUS_BUTTON_PIN);
-  int minusButtonState = digitalRead(MINUS_BUTTON_PIN);
-  unsigned long currentTime = millis();
-
-  // Check for menu button press with debounce
-  if (menuButtonState == LOW && lastMenuButtonState == HIGH && 
-      (currentTime - lastDebounceTime) > debounceDelay) {
-    menuActive = !menuActive;
-    lcd.clear();
-    lastDebounceTime = currentTime;
+// Core 1, high priority: fixed rate sampling and relay/buzzer decisions.
+// Between deadlines it sleeps on the command queue so threshold and mode
+// changes apply immediately.
+void controlTask(void* arg) {
+  controlBegin();
+  for (;;) {
+    controller.waitForCommand(controlPoll());
   }
-  lastMenuButtonState = menuButtonState;
-
-  // Menu active - allow threshold adjustment
-  if (menuActive) {
-    lcd.setCursor(0, 0);
-    lcd.print("Set Threshold:");
-    lcd.setCursor(0, 1);
-    lcd.print(moistureThreshold);
-    lcd.print("%");
-
-    // Non-blocking threshold adjustment
-    if (plusButtonState == LOW && 
-        (currentTime - lastThresholdAdjustTime) >= thresholdAdjustInterval) {
-      moistureThreshold = min(moistureThreshold + 1, 100);
-      lastThresholdAdjustTime = currentTime;
-    }
-
-    if (minusButtonState == LOW && 
-        (currentTime - lastThresholdAdjustTime) >= thresholdAdjustInterval) {
-      moistureThreshold = max(moistureThreshold - 1, 0);
-      lastThresholdAdjustTime = currentTime;
-    }
-    pref.putInt(thresh, moistureThreshold);
+}
 
+// Core 1, low priority: buttons, LCD and deferred pref commits, all driven
+// from the UI timers and coroutines. The task sleeps until the next deadline
+// or until a coroutine event is signalled.
+void uiTask(void* arg) {
+#if defined(FAST_BOOT)
+  controllerBeginDisplay();
+  backgroundInitDone();
+#endif
+  uiBegin();
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(uiPoll()));
   }
+}
 
-  // Update button states
-  lastPlusButtonState = plusButtonState;
-  lastMinusButtonState = minusButtonState;
-}
\ No newline at end of file
+#endif
@@ -0,0 +1,186 @@
+#if !defined(ESP32)
+
+// Linux entry point for [env:native]: the full controller on a host, with
+// the HTTP server on port 8080 and LCD frames printed to stdout.
+//
+//   pio run -e native && .pio/build/native/program [--adc COUNTS]
+//
+// The three task bodies run from one thread in priority order, so every
+// "task" still has a single writer. The probe reads a fixed ADC value
+// (default mid-scale); drive it from hal_native.h for anything richer.
+//
+//   .pio/build/native/program --simulate DAYS [--threshold PCT] [--seed N]
+//
+// runs the controller against SoilModel on a virtual clock instead, as fast
+// as the host allows, and prints one JSON line of season totals so control
+// changes can be compared run against run.
+// The line's "speedup" is the rate that run achieved; a 2.1 GHz Xeon with
+// g++ 12 -O2 (-std=gnu++11 -pthread) gave 35,000-75,000x real time, so a
+// 180-day season takes 3.5-7.5 minutes.
+//
+//   .pio/build/native/program --mqtt localhost[:1883] [--mqtt-interval S]
+//
+// publishes telemetry to a local broker (mosquitto -v) as the ESP32 would,
+// under irrigation/native; stop and restart the broker to exercise the
+// offline queue.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+
+#include "boot_profile.h"
+#include "controller.h"
+#include "flow_meter.h"
+#include "hal.h"
+#include "hal_native.h"
+#include "moisture_probe.h"
+#include "gpio.h"
+#include "soil_model.h"
+#include "telemetry.h"
+
+// Same cadence as the ESP32 network task's vTaskDelay(1)
+static const uint32_t networkPollMs = 1;
+
+// Peak-to-peak probe noise in ADC counts, before the driver's burst average
+static const float probeNoiseCounts = 40;
+
+static int simulate(uint32_t days, int threshold, uint32_t seed) {
+  nativeUseVirtualClock();
+  nativeUseMemoryStorage();
+  nativeSetQuiet(true);
+  if (threshold >= 0) {
+    halStoragePutInt("threshold", threshold);
+  }
+
+  SoilConfig config;
+  config.seed = seed;
+  SoilModel soil(config);
+  const ProbeCalibration& calibration = MoistureProbe::defaultCalibration;
+
+  controllerBegin();
+  controlBegin();
+  uiBegin();
+
+  uint32_t relayCycles = 0;
+  uint32_t relayOnSeconds = 0;
+  bool relayWasOn = false;
+  float pendingPulses = 0;
+  uint64_t nowMs = 0;
+  uint64_t nextSecondMs = 0;
+  uint64_t endMs = (uint64_t)days * 86400 * 1000;
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+  while (nowMs < endMs) {
+    // Physics, probe and flow meter at 1 Hz; the relay holds between samples
+    if (nowMs >= nextSecondMs) {
+      bool pumpOn = RelayOutput::read();
+      soil.step(pumpOn);
+      if (pumpOn) {
+        relayOnSeconds++;
+        pendingPulses += config.pumpLitersPerMinute / 60 * FLOW_PULSES_PER_LITER;
+        uint32_t pulses = (uint32_t)pendingPulses;
+        pendingPulses -= pulses;
+        nativeAddPulses(Board::flowMeterPin, pulses);
+      }
+
+      float raw = calibration.dry + (calibration.wet - calibration.dry) * soil.relativeSaturation() +
+                  (soil.random() - 0.5f) * probeNoiseCounts;
+      nativeSetAnalog(Board::moisturePin, raw < 0 ? 0 : raw > 4095 ? 4095 : (uint16_t)raw);
+      nextSecondMs += 1000;
+      networkPoll();
+    }
+
+    uint32_t wait = controlPoll();
+    uint32_t uiWait = uiPoll();
+    if (uiWait < wait) {
+      wait = uiWait;
+    }
+    if (nextSecondMs - nowMs < wait) {
+      wait = (uint32_t)(nextSecondMs - nowMs);
+    }
+
+    bool relayOn = RelayOutput::read();
+    if (relayOn && !relayWasOn) {
+      relayCycles++;
+    }
+    relayWasOn = relayOn;
+
+    nativeAdvanceClock(wait);
+    nowMs += wait;
+  }
+
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  const SoilTotals& t = soil.totals();
+  printf("{\"days\":%u,\"seed\":%u,\"threshold\":%d,\"waterL\":%.1f,\"rainMm\":%.1f,"
+         "\"etMm\":%.1f,\"drainageMm\":%.1f,\"runoffMm\":%.1f,\"minutesBelowWilting\":%u,"
+         "\"minutesStressed\":%u,\"relayCycles\":%u,\"relayOnMinutes\":%u,"
+         "\"finalContent\":%.3f,\"wallSeconds\":%.2f,\"speedup\":%.0f}\n",
+         (unsigned)days, (unsigned)seed, controller.threshold(), t.pumpLiters, t.rainMm, t.etMm,
+         t.drainageMm, t.runoffMm, (unsigned)(t.secondsBelowWilting / 60),
+         (unsigned)(t.secondsStressed / 60), (unsigned)relayCycles, (unsigned)(relayOnSeconds / 60),
+         soil.content(), wallSeconds, wallSeconds > 0 ? endMs / 1000.0 / wallSeconds : 0);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  uint16_t adc = 2048;
+  uint32_t simulateDays = 0;
+  int threshold = -1;
+  uint32_t seed = 1;
+  static char mqttHost[64];
+  TelemetryConfig mqtt = { nullptr, 1883, "irrigation-native", "irrigation/native", 60000, 1 };
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--adc") == 0 && i + 1 < argc) {
+      adc = (uint16_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc) {
+      simulateDays = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      threshold = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--mqtt") == 0 && i + 1 < argc) {
+      snprintf(mqttHost, sizeof(mqttHost), "%s", argv[++i]);
+      if (char* colon = strchr(mqttHost, ':')) {
+        *colon = '\0';
+        mqtt.port = (uint16_t)atoi(colon + 1);
+      }
+      mqtt.host = mqttHost;
+    } else if (strcmp(argv[i], "--mqtt-interval") == 0 && i + 1 < argc) {
+      mqtt.intervalMs = (uint32_t)atoi(argv[++i]) * 1000;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--adc COUNTS] [--mqtt HOST[:PORT]] [--mqtt-interval S]\n"
+              "       %s --simulate DAYS [--threshold PCT] [--seed N]\n",
+              argv[0], argv[0]);
+      return 2;
+    }
+  }
+  if (simulateDays) {
+    return simulate(simulateDays, threshold, seed);
+  }
+  nativeSetAnalog(Board::moisturePin, adc);
+
+  bootMark(BOOT_SETUP);
+  controllerBegin();
+  telemetryBegin(mqtt);
+  bootMark(BOOT_NETWORK);  // no radio to bring up, only the listening socket
+  setupServer();
+  controlBegin();
+  uiBegin();
+
+  for (;;) {
+    uint32_t wait = controlPoll();
+    uint32_t uiWait = uiPoll();
+    if (uiWait < wait) {
+      wait = uiWait;
+    }
+    networkPoll();
+    if (wait > 0) {
+      usleep((wait < networkPollMs ? wait : networkPollMs) * 1000);
+    }
+  }
+}
+
+#endif
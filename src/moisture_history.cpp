@@ -0,0 +1,283 @@
+#include "moisture_history.h"
+
+#include <string.h>
+
+// Block encoding, after the first point which is kept in the index:
+//
+//   0                       interval and value repeat
+//   10 <value>              interval repeats, value changed
+//   11 <dod> 0              interval changed, value repeats
+//   11 <dod> 1 <value>      both changed
+//
+//   dod:   0 <7 bits>   delta-of-delta in [-63, 64] seconds
+//          10 <12 bits> in [-2047, 2048]
+//          11 <32 bits> anything else, modulo 2^32
+//
+//   value: XOR with the previous (flags << 8 | percent)
+//          0 <bits>                         fits the previous window
+//          1 <4 lead> <4 len - 1> <bits>    new window
+//
+// Deltas start at the nominal 1 s so the second point of a block is as
+// cheap as the rest.
+
+static const uint8_t noWindow = 0xFF;
+
+static void putBits(uint8_t* data, uint16_t& pos, uint32_t value, uint8_t n) {
+  while (n) {
+    uint8_t room = 8 - (pos & 7);
+    uint8_t take = n < room ? n : room;
+    n -= take;
+    uint8_t bits = (value >> n) & ((1u << take) - 1);
+    data[pos >> 3] |= bits << (room - take);
+    pos += take;
+  }
+}
+
+static uint32_t getBits(const uint8_t* data, uint16_t& pos, uint8_t n) {
+  uint32_t value = 0;
+  while (n) {
+    uint8_t room = 8 - (pos & 7);
+    uint8_t take = n < room ? n : room;
+    n -= take;
+    value = (value << take) | ((data[pos >> 3] >> (room - take)) & ((1u << take) - 1));
+    pos += take;
+  }
+  return value;
+}
+
+static uint8_t leadingZeros16(uint16_t x) {
+  return __builtin_clz(x) - 16;
+}
+
+static uint8_t trailingZeros16(uint16_t x) {
+  return __builtin_ctz(x);
+}
+
+static uint16_t packValue(const MoistureSample& sample) {
+  return (uint16_t)(sample.flags << 8) | sample.percent;
+}
+
+MoistureHistory::MoistureHistory()
+    : newest_(0), used_(0), generation_(0), points_(0), elapsedMs_(0), lastMs_(0),
+      time_(0), delta_(1), value_(0), leading_(noWindow), trailing_(0) {
+  memset(index_, 0, sizeof(index_));
+}
+
+void MoistureHistory::startBlock(uint32_t time, uint16_t value) {
+  if (used_ == blockCount) {
+    points_ -= index_[generation_ % blockCount].count;
+  } else {
+    used_++;
+  }
+  newest_ = generation_ % blockCount;
+  generation_++;
+
+  memset(data_[newest_], 0, blockBytes);
+  BlockInfo& info = index_[newest_];
+  info.firstTime = time;
+  info.lastTime = time;
+  info.firstValue = value;
+  info.count = 1;
+  info.bits = 0;
+  points_++;
+
+  time_ = time;
+  delta_ = 1;
+  value_ = value;
+  leading_ = noWindow;
+  trailing_ = 0;
+}
+
+void MoistureHistory::encodeValue(uint8_t* data, uint16_t x) {
+  uint16_t& pos = index_[newest_].bits;
+  uint8_t lead = leadingZeros16(x);
+  uint8_t trail = trailingZeros16(x);
+
+  if (leading_ != noWindow && lead >= leading_ && trail >= trailing_) {
+    putBits(data, pos, 0, 1);
+    putBits(data, pos, x >> trailing_, 16 - leading_ - trailing_);
+    return;
+  }
+
+  uint8_t length = 16 - lead - trail;
+  putBits(data, pos, 1, 1);
+  putBits(data, pos, lead, 4);
+  putBits(data, pos, length - 1, 4);
+  putBits(data, pos, x >> trail, length);
+  leading_ = lead;
+  trailing_ = trail;
+}
+
+uint32_t MoistureHistory::append(const MoistureSample& sample) {
+  // Accumulate elapsed time so millis() wrapping after 49 days doesn't
+  // break the ordering the index relies on
+  if (used_ == 0) {
+    elapsedMs_ = sample.timeMs;
+  } else {
+    elapsedMs_ += (uint32_t)(sample.timeMs - lastMs_);
+  }
+  lastMs_ = sample.timeMs;
+
+  uint32_t time = (uint32_t)(elapsedMs_ / 1000);
+  uint16_t value = packValue(sample);
+
+  if (used_ == 0) {
+    startBlock(time, value);
+    return time;
+  }
+
+  BlockInfo& info = index_[newest_];
+  if ((size_t)info.bits + maxPointBits > blockBytes * 8 || info.count == UINT16_MAX) {
+    startBlock(time, value);
+    return time;
+  }
+
+  uint8_t* data = data_[newest_];
+  uint16_t& pos = info.bits;
+  uint32_t delta = time - time_;
+  int32_t dod = (int32_t)(delta - delta_);
+  uint16_t x = value ^ value_;
+
+  if (dod == 0) {
+    if (x == 0) {
+      putBits(data, pos, 0, 1);
+    } else {
+      putBits(data, pos, 2, 2);
+      encodeValue(data, x);
+    }
+  } else {
+    putBits(data, pos, 3, 2);
+    if (dod >= -63 && dod <= 64) {
+      putBits(data, pos, 0, 1);
+      putBits(data, pos, dod + 63, 7);
+    } else if (dod >= -2047 && dod <= 2048) {
+      putBits(data, pos, 2, 2);
+      putBits(data, pos, dod + 2047, 12);
+    } else {
+      putBits(data, pos, 3, 2);
+      putBits(data, pos, (uint32_t)dod, 32);
+    }
+    if (x == 0) {
+      putBits(data, pos, 0, 1);
+    } else {
+      putBits(data, pos, 1, 1);
+      encodeValue(data, x);
+    }
+  }
+
+  time_ = time;
+  delta_ = delta;
+  value_ = value;
+  info.lastTime = time;
+  info.count++;
+  points_++;
+  return time;
+}
+
+MoistureHistory::Reader MoistureHistory::read(uint32_t from) const {
+  // First block that ends at or after `from`
+  uint32_t lo = generation_ - used_;
+  uint32_t hi = generation_;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (index_[mid % blockCount].lastTime < from) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return Reader(this, lo, from);
+}
+
+uint32_t MoistureHistory::oldestTime() const {
+  return used_ ? index_[(generation_ - used_) % blockCount].firstTime : 0;
+}
+
+uint32_t MoistureHistory::newestTime() const {
+  return used_ ? index_[newest_].lastTime : 0;
+}
+
+uint32_t MoistureHistory::centibitsPerPoint() const {
+  if (!points_) {
+    return 0;
+  }
+  uint64_t bits = 0;
+  for (uint32_t g = generation_ - used_; g != generation_; g++) {
+    bits += index_[g % blockCount].bits + sizeof(BlockInfo) * 8;
+  }
+  return (uint32_t)(bits * 100 / points_);
+}
+
+MoistureHistory::Reader::Reader(const MoistureHistory* history, size_t block, uint32_t from)
+    : history_(history), from_(from), generation_(block), point_(0), bitPos_(0),
+      time_(0), delta_(1), value_(0), leading_(noWindow), trailing_(0) {}
+
+bool MoistureHistory::Reader::next(HistoryPoint& out) {
+  const MoistureHistory& h = *history_;
+
+  for (;;) {
+    // Past the newest block, or recycled since the read started
+    if (generation_ - (h.generation_ - h.used_) >= h.used_) {
+      return false;
+    }
+
+    const BlockInfo& info = h.index_[generation_ % blockCount];
+    if (point_ >= info.count) {
+      if (generation_ + 1 == h.generation_) {
+        return false;
+      }
+      generation_++;
+      point_ = 0;
+      continue;
+    }
+
+    const uint8_t* data = h.data_[generation_ % blockCount];
+    if (point_ == 0) {
+      time_ = info.firstTime;
+      value_ = info.firstValue;
+      delta_ = 1;
+      leading_ = noWindow;
+      trailing_ = 0;
+      bitPos_ = 0;
+    } else {
+      bool valueChanged;
+      if (!getBits(data, bitPos_, 1)) {
+        valueChanged = false;
+      } else if (!getBits(data, bitPos_, 1)) {
+        valueChanged = true;
+      } else {
+        int32_t dod;
+        if (!getBits(data, bitPos_, 1)) {
+          dod = (int32_t)getBits(data, bitPos_, 7) - 63;
+        } else if (!getBits(data, bitPos_, 1)) {
+          dod = (int32_t)getBits(data, bitPos_, 12) - 2047;
+        } else {
+          dod = (int32_t)getBits(data, bitPos_, 32);
+        }
+        delta_ += dod;
+        valueChanged = getBits(data, bitPos_, 1);
+      }
+      time_ += delta_;
+
+      if (valueChanged) {
+        if (!getBits(data, bitPos_, 1)) {
+          value_ ^= getBits(data, bitPos_, 16 - leading_ - trailing_) << trailing_;
+        } else {
+          leading_ = getBits(data, bitPos_, 4);
+          uint8_t length = getBits(data, bitPos_, 4) + 1;
+          trailing_ = 16 - leading_ - length;
+          value_ ^= getBits(data, bitPos_, length) << trailing_;
+        }
+      }
+    }
+    point_++;
+
+    if (time_ < from_) {
+      continue;
+    }
+    out.time = time_;
+    out.percent = value_ & 0xFF;
+    out.flags = value_ >> 8;
+    return true;
+  }
+}
@@ -0,0 +1,128 @@
+#include "moisture_probe.h"
+
+#include "hal.h"
+
+// Defaults for the stock probes; override per installation from build_flags
+#ifndef MOISTURE_ANALOG_DRY
+#define MOISTURE_ANALOG_DRY 4095
+#endif
+#ifndef MOISTURE_ANALOG_WET
+#define MOISTURE_ANALOG_WET 0
+#endif
+#ifndef MOISTURE_FREQUENCY_DRY_HZ
+#define MOISTURE_FREQUENCY_DRY_HZ 150000
+#endif
+#ifndef MOISTURE_FREQUENCY_WET_HZ
+#define MOISTURE_FREQUENCY_WET_HZ 60000
+#endif
+
+const ProbeCalibration AnalogProbe::defaultCalibration = {
+  MOISTURE_ANALOG_DRY, MOISTURE_ANALOG_WET
+};
+
+Fixed16 calibratedMoisture(uint32_t reading, const ProbeCalibration& calibration) {
+  if (calibration.dry == calibration.wet) {
+    return Fixed16::fromInt(0);
+  }
+  Fixed16 percent = Fixed16::ratio(((int64_t)reading - calibration.dry) * 100,
+                                   calibration.wet - calibration.dry);
+  return percent.clamp(Fixed16::fromInt(0), Fixed16::fromInt(100));
+}
+
+int calibratedPercent(uint32_t reading, const ProbeCalibration& calibration) {
+  if (calibration.dry == calibration.wet) {
+    return 0;
+  }
+  int32_t dryness = (int32_t)(((int64_t)reading - calibration.wet) * 100 /
+                              (calibration.dry - calibration.wet));
+  int32_t percent = 100 - dryness;
+  return percent < 0 ? 0 : percent > 100 ? 100 : percent;
+}
+
+AnalogProbe::AnalogProbe(int pin, int burstSize) : pin_(pin), burstSize_(burstSize) {}
+
+bool AnalogProbe::begin() {
+  halPinMode(pin_, HAL_INPUT);
+  return true;
+}
+
+uint32_t AnalogProbe::read() {
+  uint32_t sum = 0;
+  for (int i = 0; i < burstSize_; i++) {
+    sum += halAnalogRead(pin_);
+  }
+  return sum / burstSize_;
+}
+
+#if defined(ESP32)
+
+constexpr Fixed16 FrequencyProbe::smoothing;
+
+const ProbeCalibration FrequencyProbe::defaultCalibration = {
+  MOISTURE_FREQUENCY_DRY_HZ, MOISTURE_FREQUENCY_WET_HZ
+};
+
+FrequencyProbe::FrequencyProbe(int pin, pcnt_unit_t unit, uint32_t gateMs)
+    : pin_(pin), unit_(unit), gateMs_(gateMs), timer_(nullptr), lastCount_(0),
+      lastGateUs_(0), filteredKhz_(Fixed16::fromInt(0)), hz_(0), gates_(0) {}
+
+bool FrequencyProbe::begin() {
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = pin_;
+  config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = unit_;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DIS;
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = counterLimit;
+  config.counter_l_lim = 0;
+  if (pcnt_unit_config(&config) != ESP_OK) {
+    return false;
+  }
+
+  pcnt_counter_pause(unit_);
+  pcnt_counter_clear(unit_);
+  pcnt_counter_resume(unit_);
+  lastCount_ = 0;
+  lastGateUs_ = esp_timer_get_time();
+
+  esp_timer_create_args_t args = {};
+  args.callback = onGate;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "probe-gate";
+  if (esp_timer_create(&args, &timer_) != ESP_OK) {
+    return false;
+  }
+  return esp_timer_start_periodic(timer_, (uint64_t)gateMs_ * 1000) == ESP_OK;
+}
+
+void FrequencyProbe::onGate(void* arg) {
+  FrequencyProbe* probe = static_cast<FrequencyProbe*>(arg);
+  int64_t now = esp_timer_get_time();
+  int16_t count;
+  if (pcnt_get_counter_value(probe->unit_, &count) != ESP_OK) {
+    return;
+  }
+
+  // The counter resets to 0 on reaching the high limit
+  int32_t edges = (int32_t)count - probe->lastCount_;
+  if (edges < 0) {
+    edges += counterLimit;
+  }
+  uint32_t elapsedUs = (uint32_t)(now - probe->lastGateUs_);
+  // edges per ms; at most ~330 kHz, well inside Q16.16
+  Fixed16 khz = elapsedUs ? Fixed16::ratio((int64_t)edges * 1000, elapsedUs) : Fixed16::fromInt(0);
+  probe->lastCount_ = count;
+  probe->lastGateUs_ = now;
+
+  uint32_t gate = probe->gates_.load(std::memory_order_relaxed);
+  Fixed16& filtered = probe->filteredKhz_;
+  filtered = gate ? filtered + (khz - filtered) * smoothing : khz;
+  probe->hz_.store((uint32_t)filtered.roundTimes(1000), std::memory_order_relaxed);
+  probe->gates_.store(gate + 1, std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "moisture_rollup.h"
+
+#include <string.h>
+
+static void resetBucket(RollupBucket& bucket) {
+  bucket.count = 0;
+  bucket.sum = 0;
+  bucket.pumpSeconds = 0;
+  bucket.min = UINT8_MAX;
+  bucket.max = 0;
+}
+
+RollupRing::RollupRing(uint32_t resolution, RollupBucket* buckets, uint16_t capacity)
+    : buckets_(buckets), resolution_(resolution), capacity_(capacity), size_(0),
+      newest_(0), newestStart_(0) {}
+
+void RollupRing::add(uint32_t time, uint8_t percent, uint32_t pumpSeconds) {
+  uint32_t start = time - time % resolution_;
+
+  if (size_ == 0) {
+    newest_ = 0;
+    newestStart_ = start;
+    size_ = 1;
+    resetBucket(buckets_[newest_]);
+  } else if (start > newestStart_) {
+    uint32_t steps = (start - newestStart_) / resolution_;
+    if (steps >= capacity_) {
+      // Gap longer than the ring, everything retained is stale
+      steps = capacity_;
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+      newest_ = newest_ + 1 == capacity_ ? 0 : newest_ + 1;
+      resetBucket(buckets_[newest_]);
+      if (size_ < capacity_) size_++;
+    }
+    newestStart_ = start;
+  }
+
+  RollupBucket& b = buckets_[newest_];
+  b.count++;
+  b.sum += percent;
+  b.pumpSeconds += pumpSeconds;
+  if (percent < b.min) b.min = percent;
+  if (percent > b.max) b.max = percent;
+}
+
+const RollupBucket& RollupRing::at(uint16_t i) const {
+  uint32_t physical = (uint32_t)newest_ + capacity_ - (size_ - 1 - i);
+  return buckets_[physical % capacity_];
+}
+
+uint32_t RollupRing::startOf(uint16_t i) const {
+  return newestStart_ - (uint32_t)(size_ - 1 - i) * resolution_;
+}
+
+uint16_t RollupRing::find(uint32_t time) const {
+  if (size_ == 0 || time <= startOf(0)) {
+    return 0;
+  }
+  uint32_t offset = (time - startOf(0)) / resolution_;
+  return offset >= size_ ? size_ : (uint16_t)offset;
+}
+
+MoistureRollups::MoistureRollups()
+    : rings_{ RollupRing(60, minutes_, sizeof(minutes_) / sizeof(minutes_[0])),
+              RollupRing(900, quarters_, sizeof(quarters_) / sizeof(quarters_[0])),
+              RollupRing(3600, hours_, sizeof(hours_) / sizeof(hours_[0])),
+              RollupRing(86400, days_, sizeof(days_) / sizeof(days_[0])) },
+      lastTime_(0), lastRelayOn_(false), started_(false) {
+  memset(minutes_, 0, sizeof(minutes_));
+  memset(quarters_, 0, sizeof(quarters_));
+  memset(hours_, 0, sizeof(hours_));
+  memset(days_, 0, sizeof(days_));
+}
+
+void MoistureRollups::append(uint32_t time, const MoistureSample& sample) {
+  // Attribute the interval since the previous sample to the pump if the
+  // relay was on for it
+  uint32_t pumpSeconds = 0;
+  if (started_ && lastRelayOn_ && time - lastTime_ <= maxPumpGap) {
+    pumpSeconds = time - lastTime_;
+  }
+  lastTime_ = time;
+  lastRelayOn_ = sample.flags & SAMPLE_RELAY_ON;
+  started_ = true;
+
+  for (int i = 0; i < ROLLUP_LEVELS; i++) {
+    rings_[i].add(time, sample.percent, pumpSeconds);
+  }
+}
+
+const RollupRing& MoistureRollups::select(uint32_t from, uint32_t to, uint32_t maxPoints) const {
+  uint32_t span = to > from ? to - from : 0;
+  for (int i = 0; i < ROLLUP_LEVELS - 1; i++) {
+    const RollupRing& ring = rings_[i];
+    bool fits = span / ring.resolution() + 1 <= maxPoints;
+    // A ring that hasn't wrapped yet holds everything since boot
+    bool covers = ring.size() < ring.capacity() || ring.startOf(0) <= from;
+    if (fits && covers) {
+      return ring;
+    }
+  }
+  return rings_[ROLLUP_LEVELS - 1];
+}
@@ -0,0 +1,273 @@
+#include "mqtt_client.h"
+
+#include <string.h>
+
+#include "hal.h"
+
+enum MqttPacket : uint8_t {
+  MQTT_CONNECT = 0x10,
+  MQTT_CONNACK = 0x20,
+  MQTT_PUBLISH = 0x30,
+  MQTT_PUBACK = 0x40,
+  MQTT_SUBSCRIBE = 0x82,   // with the reserved flag bits
+  MQTT_SUBACK = 0x90,
+  MQTT_PINGREQ = 0xC0,
+  MQTT_PINGRESP = 0xD0,
+  MQTT_DISCONNECT = 0xE0,
+};
+
+MqttClient::MqttClient()
+    : handler_(nullptr), handlerArg_(nullptr), open_(false), connected_(false),
+      keepAliveMs_(0), lastPacketId_(0), inflight_(0), lastTxMs_(0), pingSentMs_(0),
+      txLength_(0), rxLength_(0) {}
+
+void MqttClient::setHandler(MessageHandler handler, void* arg) {
+  handler_ = handler;
+  handlerArg_ = arg;
+}
+
+bool MqttClient::connect(const char* host, uint16_t port, const char* clientId,
+                         uint16_t keepAliveS, const char* willTopic, const char* willPayload,
+                         uint32_t timeoutMs) {
+  drop();
+  if (!halTcpConnect(host, port, timeoutMs)) {
+    return false;
+  }
+  open_ = true;
+  keepAliveMs_ = (uint32_t)keepAliveS * 1000;
+
+  size_t idLength = strlen(clientId);
+  size_t topicLength = strlen(willTopic);
+  size_t willLength = strlen(willPayload);
+  // Clean session, will at QoS 1, retained
+  uint8_t flags = 0x02 | 0x04 | (1 << 3) | 0x20;
+  if (!beginPacket(MQTT_CONNECT, 10 + 2 + idLength + 2 + topicLength + 2 + willLength)) {
+    drop();
+    return false;
+  }
+  putString("MQTT", 4);
+  putByte(4);   // protocol level 3.1.1
+  putByte(flags);
+  putU16(keepAliveS);
+  putString(clientId, idLength);
+  putString(willTopic, topicLength);
+  putString(willPayload, willLength);
+  if (!sendPacket()) {
+    drop();
+    return false;
+  }
+  return true;
+}
+
+void MqttClient::disconnect() {
+  if (open_ && beginPacket(MQTT_DISCONNECT, 0)) {
+    sendPacket();
+  }
+  drop();
+}
+
+void MqttClient::drop() {
+  if (open_) {
+    halTcpClose();
+  }
+  open_ = false;
+  connected_ = false;
+  inflight_ = 0;
+  pingSentMs_ = 0;
+  rxLength_ = 0;
+}
+
+bool MqttClient::subscribe(const char* topic, uint8_t qos) {
+  size_t length = strlen(topic);
+  if (!connected_ || !beginPacket(MQTT_SUBSCRIBE, 2 + 2 + length + 1)) {
+    return false;
+  }
+  putU16(nextPacketId());
+  putString(topic, length);
+  putByte(qos);
+  return sendPacket();
+}
+
+bool MqttClient::publish(const char* topic, const char* payload, size_t length, uint8_t qos,
+                         bool retain, bool dup) {
+  if (!connected_ || (qos && inflight_)) {
+    return false;
+  }
+  size_t topicLength = strlen(topic);
+  uint8_t header = MQTT_PUBLISH | (dup ? 0x08 : 0) | (qos ? 0x02 : 0) | (retain ? 0x01 : 0);
+  if (!beginPacket(header, 2 + topicLength + (qos ? 2 : 0) + length)) {
+    return false;
+  }
+  putString(topic, topicLength);
+  uint16_t id = 0;
+  if (qos) {
+    id = nextPacketId();
+    putU16(id);
+  }
+  memcpy(tx_ + txLength_, payload, length);
+  txLength_ += length;
+  if (!sendPacket()) {
+    return false;
+  }
+  inflight_ = id;
+  return true;
+}
+
+bool MqttClient::poll(uint32_t nowMs) {
+  if (!open_) {
+    return false;
+  }
+  if (!readPackets()) {
+    drop();
+    return false;
+  }
+
+  // Ping when we've been quiet for half the keep-alive; the broker has
+  // the rest of it to answer
+  if (connected_ && keepAliveMs_) {
+    if (pingSentMs_ && nowMs - pingSentMs_ > keepAliveMs_ / 2) {
+      drop();
+      return false;
+    }
+    if (!pingSentMs_ && nowMs - lastTxMs_ >= keepAliveMs_ / 2) {
+      if (!beginPacket(MQTT_PINGREQ, 0) || !sendPacket()) {
+        drop();
+        return false;
+      }
+      pingSentMs_ = nowMs ? nowMs : 1;
+    }
+  }
+  return true;
+}
+
+bool MqttClient::beginPacket(uint8_t header, size_t remaining) {
+  txLength_ = 0;
+  if (remaining + 5 > txBytes) {
+    return false;
+  }
+  putByte(header);
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    putByte(remaining ? digit | 0x80 : digit);
+  } while (remaining);
+  return true;
+}
+
+void MqttClient::putU16(uint16_t v) {
+  putByte(v >> 8);
+  putByte(v & 0xFF);
+}
+
+void MqttClient::putString(const char* s, size_t length) {
+  putU16((uint16_t)length);
+  memcpy(tx_ + txLength_, s, length);
+  txLength_ += length;
+}
+
+bool MqttClient::sendPacket() {
+  if (!halTcpWrite(tx_, txLength_)) {
+    return false;
+  }
+  lastTxMs_ = halMillis();
+  return true;
+}
+
+uint16_t MqttClient::nextPacketId() {
+  if (++lastPacketId_ == 0) {
+    lastPacketId_ = 1;
+  }
+  return lastPacketId_;
+}
+
+// Appends what the socket has and handles every complete packet in rx_
+bool MqttClient::readPackets() {
+  for (;;) {
+    int n = halTcpRead(rx_ + rxLength_, rxBytes - rxLength_);
+    if (n < 0) {
+      return false;
+    }
+    rxLength_ += n;
+
+    size_t offset = 0;
+    for (;;) {
+      // Fixed header: type byte, then a 1-4 byte remaining length
+      size_t remaining = 0;
+      size_t i = offset + 1;
+      int shift = 0;
+      bool complete = false;
+      while (i < rxLength_ && shift <= 21) {
+        uint8_t digit = rx_[i++];
+        remaining |= (size_t)(digit & 0x7F) << shift;
+        shift += 7;
+        if (!(digit & 0x80)) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete) {
+        if (shift > 21) {
+          return false;
+        }
+        break;
+      }
+      if (i + remaining > rxLength_) {
+        if (i + remaining - offset > rxBytes) {
+          return false;   // bigger than we could ever buffer
+        }
+        break;
+      }
+      handlePacket(rx_[offset], rx_ + i, remaining);
+      offset = i + remaining;
+    }
+    memmove(rx_, rx_ + offset, rxLength_ - offset);
+    rxLength_ -= offset;
+
+    if (n == 0 || rxLength_ == rxBytes) {
+      return true;
+    }
+  }
+}
+
+void MqttClient::handlePacket(uint8_t header, const uint8_t* body, size_t length) {
+  switch (header & 0xF0) {
+    case MQTT_CONNACK:
+      connected_ = length >= 2 && body[1] == 0;
+      break;
+    case MQTT_PUBACK:
+      if (length >= 2 && ((body[0] << 8) | body[1]) == inflight_) {
+        inflight_ = 0;
+      }
+      break;
+    case MQTT_PINGRESP:
+      pingSentMs_ = 0;
+      break;
+    case MQTT_PUBLISH: {
+      if (length < 2) {
+        return;
+      }
+      size_t topicLength = (body[0] << 8) | body[1];
+      uint8_t qos = (header >> 1) & 0x03;
+      size_t payloadAt = 2 + topicLength + (qos ? 2 : 0);
+      if (payloadAt > length) {
+        return;
+      }
+      // Longer topics are cut short; ours are a prefix plus "/cmd"
+      char topic[64];
+      size_t copy = topicLength < sizeof(topic) - 1 ? topicLength : sizeof(topic) - 1;
+      memcpy(topic, body + 2, copy);
+      topic[copy] = '\0';
+      if (qos == 1 && beginPacket(MQTT_PUBACK, 2)) {
+        putByte(body[2 + topicLength]);
+        putByte(body[3 + topicLength]);
+        sendPacket();
+      }
+      if (handler_) {
+        handler_(topic, (const char*)body + payloadAt, length - payloadAt, handlerArg_);
+      }
+      break;
+    }
+    default:
+      break;   // SUBACK, and anything a broker shouldn't send
+  }
+}
@@ -0,0 +1,133 @@
+#include "power.h"
+
+#include <atomic>
+
+#include "hal.h"
+
+// Set from both cores (pump: control task, radio: network task)
+static std::atomic<uint8_t> holds(0);
+
+// Absolute wake deadline of each blocked task, 0 while it runs. The network
+// task doesn't report: with the radio down it has nothing to serve.
+static volatile uint64_t deadlineUs[TASK_COUNT];
+
+// Network task only, like every POWER_HOLD_RADIO change
+static uint64_t radioOnSinceUs = 0;
+static uint64_t radioOnUs = 0;
+
+static uint32_t sleeps = 0;
+static uint32_t timerWakes = 0;
+static uint32_t gpioWakes = 0;
+static uint32_t refused = 0;
+static uint64_t sleepUs = 0;
+static uint32_t maxLatenessUs = 0;     // timer wake after the deadline
+
+// Wake to the first task running again
+static volatile uint64_t pendingWakeUs = 0;
+static uint32_t wakeLatencyCount = 0;
+static uint64_t wakeLatencySumUs = 0;
+static uint32_t wakeLatencyMaxUs = 0;
+
+void powerBegin() {
+  deadlineUs[TASK_NETWORK] = UINT64_MAX;
+}
+
+void powerTaskBlocking(TaskId task, uint32_t ms) {
+  deadlineUs[task] = halMicros() + (uint64_t)ms * 1000;
+}
+
+void powerTaskRunning(TaskId task) {
+  deadlineUs[task] = 0;
+  uint64_t wokeAt = pendingWakeUs;
+  if (wokeAt) {
+    pendingWakeUs = 0;
+    uint32_t latency = (uint32_t)(halMicros() - wokeAt);
+    wakeLatencyCount++;
+    wakeLatencySumUs += latency;
+    if (latency > wakeLatencyMaxUs) {
+      wakeLatencyMaxUs = latency;
+    }
+  }
+}
+
+void powerHold(PowerHold reason, bool held) {
+  uint8_t was = held ? holds.fetch_or(reason) : holds.fetch_and((uint8_t)~reason);
+  if (reason == POWER_HOLD_RADIO && held != !!(was & reason)) {
+    uint64_t now = halMicros();
+    if (held) {
+      radioOnSinceUs = now;
+    } else {
+      radioOnUs += now - radioOnSinceUs;
+    }
+  }
+}
+
+bool powerIdle() {
+  if (holds.load()) {
+    return false;
+  }
+  uint64_t wake = UINT64_MAX;
+  for (int i = 0; i < TASK_COUNT; i++) {
+    uint64_t d = deadlineUs[i];
+    if (d == 0) {
+      return false;
+    }
+    if (d < wake) {
+      wake = d;
+    }
+  }
+  uint64_t now = halMicros();
+  if (wake <= now || wake - now < powerMinSleepUs) {
+    return false;
+  }
+
+  HalWakeCause cause = halLightSleep(wake - now);
+  uint64_t woke = halMicros();
+  if (cause == HAL_WAKE_NONE) {
+    refused++;
+    return false;
+  }
+  sleeps++;
+  sleepUs += woke - now;
+  if (cause == HAL_WAKE_GPIO) {
+    gpioWakes++;
+  } else {
+    timerWakes++;
+    if (woke > wake && woke - wake > maxLatenessUs) {
+      maxLatenessUs = (uint32_t)(woke - wake);
+    }
+  }
+  pendingWakeUs = woke;
+  return true;
+}
+
+void powerStatsJson(TextBuffer& out) {
+  uint64_t now = halMicros();
+  uint8_t held = holds.load(std::memory_order_relaxed);
+  uint64_t radio = radioOnUs + ((held & POWER_HOLD_RADIO) ? now - radioOnSinceUs : 0);
+  float sleepFraction = now ? (float)sleepUs / now : 0;
+  float radioFraction = now ? (float)radio / now : 0;
+  float busyFraction = 0;
+  for (int i = 0; i < TASK_COUNT; i++) {
+    busyFraction += taskStats((TaskId)i).cpuPermille / 1000.0f;
+  }
+  if (busyFraction > 1) {
+    busyFraction = 1;
+  }
+  float ma = sleepFraction * powerLightSleepMa + (1 - sleepFraction) * powerIdleMa +
+             busyFraction * (powerActiveMa - powerIdleMa) + radioFraction * powerRadioMa;
+
+  out.appendf("{\"holds\":{\"radio\":%s,\"pump\":%s,\"probe\":%s},"
+              "\"sleeps\":%u,\"timerWakes\":%u,\"gpioWakes\":%u,\"refused\":%u,"
+              "\"sleepMs\":%llu,\"sleepPermille\":%u,\"radioOnMs\":%llu,"
+              "\"timerLatenessMaxUs\":%u,\"wakeToTaskUs\":{\"avg\":%u,\"max\":%u},"
+              "\"estimatedMa\":%.1f}",
+              (held & POWER_HOLD_RADIO) ? "true" : "false",
+              (held & POWER_HOLD_PUMP) ? "true" : "false",
+              (held & POWER_HOLD_PROBE) ? "true" : "false", (unsigned)sleeps,
+              (unsigned)timerWakes, (unsigned)gpioWakes, (unsigned)refused,
+              (unsigned long long)(sleepUs / 1000), (unsigned)(sleepFraction * 1000),
+              (unsigned long long)(radio / 1000), (unsigned)maxLatenessUs,
+              (unsigned)(wakeLatencyCount ? wakeLatencySumUs / wakeLatencyCount : 0),
+              (unsigned)wakeLatencyMaxUs, ma);
+}
@@ -0,0 +1,77 @@
+#include "route_trace.h"
+
+#include <string.h>
+
+#include "cycle_counter.h"
+#include "hal.h"
+#include "heap_guard.h"
+
+RouteTracer::RouteTracer()
+    : count_(0), current_(-1), startCycles_(0), startFreeHeap_(0), startAllocations_(0) {
+  memset(routes_, 0, sizeof(routes_));
+}
+
+int RouteTracer::add(const char* path) {
+  if (count_ == maxRoutes) {
+    return -1;
+  }
+  routes_[count_].path = path;
+  return count_++;
+}
+
+void RouteTracer::begin(int route) {
+  current_ = route;
+  if (route < 0) {
+    return;
+  }
+  startAllocations_ = heapGuardAllocations(TASK_NETWORK);
+  startFreeHeap_ = halFreeHeap();
+  startCycles_ = cycleCount();
+}
+
+void RouteTracer::end() {
+  if (current_ < 0) {
+    return;
+  }
+  uint32_t cycles = cycleCount() - startCycles_;
+  int32_t heapDelta = (int32_t)(halFreeHeap() - startFreeHeap_);
+
+  RouteStats& r = routes_[current_];
+  r.requests++;
+  r.totalCycles += cycles;
+  if (cycles > r.maxCycles) r.maxCycles = cycles;
+  r.heapDelta += heapDelta;
+  if (heapDelta < r.worstHeapDelta) r.worstHeapDelta = heapDelta;
+  r.allocations += heapGuardAllocations(TASK_NETWORK) - startAllocations_;
+  current_ = -1;
+}
+
+void RouteTracer::addBytes(size_t bytes) {
+  if (current_ >= 0) {
+    routes_[current_].responseBytes += bytes;
+  }
+}
+
+void RouteTracer::json(TextBuffer& out) const {
+  uint64_t allCycles = 0;
+  for (int i = 0; i < count_; i++) {
+    allCycles += routes_[i].totalCycles;
+  }
+
+  uint32_t cpm = cyclesPerMicrosecond();
+  out.appendf("{\"guard\":%s,\"routes\":[", heapGuardEnabled() ? "true" : "false");
+  for (int i = 0; i < count_; i++) {
+    const RouteStats& r = routes_[i];
+    uint32_t meanUs = r.requests ? (uint32_t)(r.totalCycles / r.requests / cpm) : 0;
+    uint32_t sharePermille = allCycles ? (uint32_t)(r.totalCycles * 1000 / allCycles) : 0;
+    out.appendf("%s{\"path\":\"%s\",\"requests\":%u,\"totalMs\":%u,\"meanUs\":%u,\"maxUs\":%u,"
+                "\"timePermille\":%u,\"bytes\":%u,\"heapDelta\":%d,\"worstHeapDelta\":%d,"
+                "\"allocations\":%u}",
+                i ? "," : "", r.path, (unsigned)r.requests,
+                (unsigned)(r.totalCycles / cpm / 1000), (unsigned)meanUs,
+                (unsigned)(r.maxCycles / cpm), (unsigned)sharePermille,
+                (unsigned)r.responseBytes, (int)r.heapDelta, (int)r.worstHeapDelta,
+                (unsigned)r.allocations);
+  }
+  out.append("]}");
+}
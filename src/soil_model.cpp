@@ -0,0 +1,98 @@
+#include "soil_model.h"
+
+#include <math.h>
+#include <string.h>
+
+static const uint32_t secondsPerDay = 86400;
+static const uint32_t secondsPerHour = 3600;
+static const float pi = 3.14159265f;
+
+SoilModel::SoilModel(const SoilConfig& config)
+    : config_(config), rng_(config.seed ? config.seed : 1), seconds_(0),
+      storageMm_(config.initialContent * config.rootDepthMm), et0Today_(0), rainStart_(0),
+      rainEnd_(0) {
+  memset(&totals_, 0, sizeof(totals_));
+  startDay();
+}
+
+float SoilModel::random() {
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 17;
+  rng_ ^= rng_ << 5;
+  return (rng_ >> 8) * (1.0f / 16777216.0f);
+}
+
+void SoilModel::startDay() {
+  uint32_t day = seconds_ / secondsPerDay;
+  float season = config_.seasonDays ? (float)(day % config_.seasonDays) / config_.seasonDays : 0;
+  et0Today_ = config_.et0MinMmPerDay +
+              (config_.et0MaxMmPerDay - config_.et0MinMmPerDay) * sinf(pi * season);
+
+  rainStart_ = rainEnd_ = 0;
+  if (random() < config_.rainChance) {
+    float mm = -config_.rainMeanMm * logf(1 - random());
+    rainStart_ = seconds_ + (uint32_t)(random() * 20) * secondsPerHour;
+    rainEnd_ = rainStart_ + (uint32_t)(mm / config_.rainMmPerHour * secondsPerHour);
+  }
+}
+
+void SoilModel::step(bool pumpOn) {
+  const SoilConfig& c = config_;
+  double inMm = 0;
+
+  if (seconds_ >= rainStart_ && seconds_ < rainEnd_) {
+    double rain = c.rainMmPerHour / secondsPerHour;
+    totals_.rainMm += rain;
+    inMm += rain;
+  }
+  if (pumpOn) {
+    double liters = c.pumpLitersPerMinute / 60;
+    totals_.pumpLiters += liters;
+    inMm += liters / c.bedAreaM2;
+  }
+
+  // Half-sine over 06:00-18:00 integrates to the day's ET0
+  float hour = (float)(seconds_ % secondsPerDay) / secondsPerHour;
+  double etMm = 0;
+  if (hour >= 6 && hour < 18) {
+    float theta = content();
+    float stressPoint = c.fieldCapacity - c.depletionFraction * (c.fieldCapacity - c.wiltingPoint);
+    float ks = 1;
+    if (theta < stressPoint) {
+      ks = theta > c.wiltingPoint ? (theta - c.wiltingPoint) / (stressPoint - c.wiltingPoint) : 0;
+    }
+    etMm = et0Today_ * c.cropCoefficient * ks * pi / 24 * sinf(pi * (hour - 6) / 12) /
+           secondsPerHour;
+  }
+
+  double fieldCapacityMm = c.fieldCapacity * c.rootDepthMm;
+  double drainMm = 0;
+  if (storageMm_ > fieldCapacityMm) {
+    drainMm = (storageMm_ - fieldCapacityMm) / (c.drainageHours * secondsPerHour);
+  }
+
+  storageMm_ += inMm - etMm - drainMm;
+  totals_.etMm += etMm;
+  totals_.drainageMm += drainMm;
+
+  double saturationMm = c.saturation * c.rootDepthMm;
+  if (storageMm_ > saturationMm) {
+    totals_.runoffMm += storageMm_ - saturationMm;
+    storageMm_ = saturationMm;
+  }
+  if (storageMm_ < 0) {
+    storageMm_ = 0;
+  }
+
+  float theta = content();
+  if (theta < c.wiltingPoint) {
+    totals_.secondsBelowWilting++;
+  }
+  if (theta < c.fieldCapacity - c.depletionFraction * (c.fieldCapacity - c.wiltingPoint)) {
+    totals_.secondsStressed++;
+  }
+
+  if (++seconds_ % secondsPerDay == 0) {
+    startDay();
+  }
+}
@@ -0,0 +1,130 @@
+#include "task_manager.h"
+
+#include "hal.h"
+#include "latency_histogram.h"
+#include "trace.h"
+
+// CPU usage is reported over fixed one second windows
+static const uint32_t statsWindowUs = 1000000;
+
+// Stack budgets are in bytes (ESP-IDF convention):
+//  - network: WebServer::handleClient() parses headers into Strings and the
+//    handlers format JSON with vsnprintf, same budget as the Arduino
+//    loopTask (8 KB).
+//  - control: ADC read, relay/buzzer GPIO and a few locals, 3 KB is ample.
+//  - ui:      LiquidCrystal_I2C goes through Wire and Print, Preferences
+//             commits go through NVS which needs ~2 KB on its own (4 KB).
+// Stacks and TCBs are static so they don't show up in heap watermarks.
+static const uint32_t networkStackBytes = 8192;
+static const uint32_t controlStackBytes = 3072;
+static const uint32_t uiStackBytes = 4096;
+
+#if defined(ESP32)
+static StackType_t networkStack[networkStackBytes];
+static StackType_t controlStack[controlStackBytes];
+static StackType_t uiStack[uiStackBytes];
+#define TASK_STACK(stack) stack, {}, nullptr,
+#else
+#define TASK_STACK(stack)
+#endif
+
+struct TaskEntry {
+  TaskStats stats;
+#if defined(ESP32)
+  StackType_t* stack;
+  StaticTask_t tcb;
+  TaskHandle_t handle;
+#endif
+  uint32_t busyStartUs;
+  uint32_t busyStartCycles;
+  uint32_t windowStartUs;
+  uint32_t windowBusyUs;
+};
+
+static TaskEntry tasks[TASK_COUNT] = {
+  { { "network", 0, 1, networkStackBytes, 0, 0, 0 }, TASK_STACK(networkStack) 0, 0, 0, 0 },
+  { { "control", 1, 3, controlStackBytes, 0, 0, 0 }, TASK_STACK(controlStack) 0, 0, 0, 0 },
+  { { "ui",      1, 2, uiStackBytes,      0, 0, 0 }, TASK_STACK(uiStack)      0, 0, 0, 0 },
+};
+
+static uint32_t lastControlTickUs = 0;
+static int32_t controlJitterMaxUs = 0;
+
+#if defined(ESP32)
+bool startTask(TaskId id, TaskFunction_t fn) {
+  TaskEntry& t = tasks[id];
+  t.windowStartUs = (uint32_t)halMicros();
+  t.handle = xTaskCreateStaticPinnedToCore(fn, t.stats.name, t.stats.stackBytes, nullptr,
+                                          t.stats.priority, t.stack, &t.tcb, t.stats.core);
+  return t.handle != nullptr;
+}
+
+TaskHandle_t taskHandle(TaskId id) {
+  return tasks[id].handle;
+}
+#endif
+
+void taskBusyBegin(TaskId id) {
+  traceClockSync();
+  tasks[id].busyStartUs = (uint32_t)halMicros();
+  tasks[id].busyStartCycles = cycleCount();
+}
+
+void taskBusyEnd(TaskId id) {
+  TaskEntry& t = tasks[id];
+  latency((LatencySection)id).record(cycleCount() - t.busyStartCycles);
+  uint32_t now = (uint32_t)halMicros();
+  uint32_t busy = now - t.busyStartUs;
+
+  t.windowBusyUs += busy;
+  if (busy > t.stats.maxBusyUs) {
+    t.stats.maxBusyUs = busy;
+  }
+
+  uint32_t elapsed = now - t.windowStartUs;
+  if (elapsed >= statsWindowUs) {
+    t.stats.cpuPermille = (uint16_t)((uint64_t)t.windowBusyUs * 1000 / elapsed);
+    t.windowBusyUs = 0;
+    t.windowStartUs = now;
+  }
+}
+
+void recordControlTick(uint32_t nominalUs) {
+  uint32_t now = (uint32_t)halMicros();
+  if (lastControlTickUs != 0) {
+    int32_t jitter = (int32_t)(now - lastControlTickUs - nominalUs);
+    if (jitter < 0) jitter = -jitter;
+    if (jitter > controlJitterMaxUs) {
+      controlJitterMaxUs = jitter;
+    }
+  }
+  lastControlTickUs = now;
+}
+
+const TaskStats& taskStats(TaskId id) {
+  return tasks[id].stats;
+}
+
+bool taskStackFree(TaskId id, uint32_t& bytes) {
+#if defined(ESP32)
+  if (tasks[id].handle) {
+    bytes = uxTaskGetStackHighWaterMark(tasks[id].handle);
+    return true;
+  }
+#endif
+  return false;
+}
+
+void taskStatsJson(TextBuffer& out) {
+  out.append("{\"tasks\":[");
+  for (int i = 0; i < TASK_COUNT; i++) {
+    TaskEntry& t = tasks[i];
+    taskStackFree((TaskId)i, t.stats.stackFreeBytes);
+    out.appendf("%s{\"name\":\"%s\",\"core\":%u,\"priority\":%u,\"stack\":%u,"
+                "\"stackFree\":%u,\"cpuPermille\":%u,\"maxBusyUs\":%u}",
+                i ? "," : "", t.stats.name, t.stats.core, t.stats.priority,
+                (unsigned)t.stats.stackBytes, (unsigned)t.stats.stackFreeBytes,
+                t.stats.cpuPermille, (unsigned)t.stats.maxBusyUs);
+  }
+  out.appendf("],\"controlJitterMaxUs\":%d}", (int)controlJitterMaxUs);
+}
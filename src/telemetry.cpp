@@ -0,0 +1,392 @@
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller.h"
+#include "hal.h"
+#include "mqtt_client.h"
+
+static const uint16_t keepAliveS = 60;
+static const uint32_t connectTimeoutMs = 2000;    // TCP, blocks the network task
+static const uint32_t connackTimeoutMs = 5000;
+static const uint32_t minBackoffMs = 1000;
+static const uint32_t maxBackoffMs = 60000;
+static const size_t messageHeaderBytes = 160;
+
+static TelemetryConfig config;
+static bool enabled = false;
+static MqttClient mqtt;
+
+static char telemetryTopic[64];
+static char statusTopic[64];
+static char commandTopic[64];
+
+// Batch being collected; deltas only, the header is added when it closes
+static char deltaStorage[halStorageBlobBytes - messageHeaderBytes];
+static TextBuffer deltas(deltaStorage, sizeof(deltaStorage));
+static uint32_t batchStartMs = 0;
+static uint32_t batchEndMs = 0;
+static uint32_t batchSamples = 0;
+static uint32_t batchSum = 0;
+static uint8_t batchMin = 0;
+static uint8_t batchMax = 0;
+static uint32_t batchTruncated = 0;
+static uint32_t sequence = 0;
+
+static uint8_t lastPercent = 0;
+static uint8_t lastFlags = 0;
+static int lastThreshold = -1;
+
+// The message being published: fresh from a batch, or the queue's oldest
+static char message[halStorageBlobBytes];
+static size_t messageLength = 0;
+static bool pending = false;
+static bool fromQueue = false;
+static bool sent = false;
+static uint32_t sentMs = 0;
+
+// Offline queue: blobs "mq<slot>", sequence numbers of the oldest and next
+static uint32_t queueHead = 0;
+static uint32_t queueTail = 0;
+
+static bool sessionUp = false;
+static uint32_t nextAttemptMs = 0;
+static uint32_t backoffMs = minBackoffMs;
+static uint32_t connectStartMs = 0;
+static uint32_t downSinceMs = 0;
+static uint32_t sessionStartMs = 0;
+
+struct TelemetryStats {
+  uint32_t batches;
+  uint32_t published;
+  uint32_t acked;
+  uint64_t bytesAcked;
+  uint32_t queued;
+  uint32_t queueDropped;
+  uint32_t attempts;
+  uint32_t connects;
+  uint32_t lastReconnectMs;   // link lost (or boot) to CONNACK
+  uint32_t maxReconnectMs;
+  uint64_t totalReconnectMs;
+  uint64_t connectedMs;       // completed sessions
+  uint32_t maxAckMs;
+  uint64_t totalAckMs;
+  uint32_t drainMessages;     // last backlog sent after reconnecting
+  uint32_t drainMs;
+  uint32_t commands;
+};
+
+static TelemetryStats stats;
+static uint32_t drainStartMs = 0;
+static uint32_t drainCount = 0;
+
+static void queueKey(uint32_t n, char* key) {
+  snprintf(key, 8, "mq%u", (unsigned)(n % telemetryQueueSlots));
+}
+
+static void queuePush(const char* data, size_t length) {
+  if (queueTail - queueHead == (uint32_t)telemetryQueueSlots) {
+    queueHead++;
+    stats.queueDropped++;
+  }
+  char key[8];
+  queueKey(queueTail, key);
+  halStoragePutBytes(key, data, length);
+  queueTail++;
+  halStoragePutUInt("mqHead", queueHead);
+  halStoragePutUInt("mqTail", queueTail);
+  stats.queued++;
+}
+
+static bool queuePeek() {
+  while (queueHead != queueTail) {
+    char key[8];
+    queueKey(queueHead, key);
+    messageLength = halStorageGetBytes(key, message, sizeof(message));
+    if (messageLength) {
+      return true;
+    }
+    queueHead++;   // unreadable slot, skip it
+  }
+  return false;
+}
+
+static void queuePop() {
+  char key[8];
+  queueKey(queueHead, key);
+  halStorageRemove(key);
+  queueHead++;
+  halStoragePutUInt("mqHead", queueHead);
+}
+
+static void onCommand(const char* topic, const char* payload, size_t length, void* arg) {
+  if (strcmp(topic, commandTopic) != 0) {
+    return;
+  }
+  char text[96];
+  size_t n = length < sizeof(text) - 1 ? length : sizeof(text) - 1;
+  memcpy(text, payload, n);
+  text[n] = '\0';
+
+  if (const char* at = strstr(text, "\"threshold\"")) {
+    if ((at = strchr(at, ':'))) {
+      controller.post(CMD_SET_THRESHOLD, (int16_t)atoi(at + 1));
+      stats.commands++;
+    }
+  }
+  if (const char* at = strstr(text, "\"mode\"")) {
+    if (strstr(at, "\"wifi\"")) {
+      controller.post(CMD_SET_MODE, 1);
+      stats.commands++;
+    } else if (strstr(at, "\"manual\"")) {
+      controller.post(CMD_SET_MODE, 0);
+      stats.commands++;
+    }
+  }
+}
+
+void telemetryBegin(const TelemetryConfig& c) {
+  config = c;
+  enabled = config.host != nullptr;
+  if (!enabled) {
+    return;
+  }
+  snprintf(telemetryTopic, sizeof(telemetryTopic), "%s/telemetry", config.topicPrefix);
+  snprintf(statusTopic, sizeof(statusTopic), "%s/status", config.topicPrefix);
+  snprintf(commandTopic, sizeof(commandTopic), "%s/cmd", config.topicPrefix);
+  mqtt.setHandler(onCommand, nullptr);
+
+  queueHead = halStorageGetUInt("mqHead", 0);
+  queueTail = halStorageGetUInt("mqTail", 0);
+  if (queueTail - queueHead > (uint32_t)telemetryQueueSlots) {
+    queueHead = queueTail = 0;
+  }
+  downSinceMs = halMillis();
+}
+
+void telemetryRecord(const MoistureSample& sample, int threshold) {
+  if (!enabled) {
+    return;
+  }
+  if (batchSamples == 0) {
+    batchStartMs = sample.timeMs;
+    batchMin = batchMax = sample.percent;
+  }
+  batchEndMs = sample.timeMs;
+  batchSamples++;
+  batchSum += sample.percent;
+  batchMin = sample.percent < batchMin ? sample.percent : batchMin;
+  batchMax = sample.percent > batchMax ? sample.percent : batchMax;
+
+  bool first = deltas.length() == 0;
+  if (!first && sample.percent == lastPercent && sample.flags == lastFlags &&
+      threshold == lastThreshold) {
+    return;
+  }
+
+  // Worst case entry is about 48 bytes; past that, count what's lost
+  if (deltas.capacity() - deltas.length() < 56) {
+    batchTruncated++;
+  } else {
+    deltas.appendf("%s{\"t\":%u", first ? "" : ",",
+                   (unsigned)((sample.timeMs - batchStartMs) / 1000));
+    if (first || sample.percent != lastPercent) {
+      deltas.appendf(",\"p\":%u", sample.percent);
+    }
+    uint8_t changed = first ? 0xFF : sample.flags ^ lastFlags;
+    if (changed & SAMPLE_RELAY_ON) {
+      deltas.appendf(",\"r\":%u", (sample.flags & SAMPLE_RELAY_ON) ? 1 : 0);
+    }
+    if (changed & SAMPLE_BUZZER_ON) {
+      deltas.appendf(",\"b\":%u", (sample.flags & SAMPLE_BUZZER_ON) ? 1 : 0);
+    }
+    if (changed & SAMPLE_WIFI_MODE) {
+      deltas.appendf(",\"m\":%u", (sample.flags & SAMPLE_WIFI_MODE) ? 1 : 0);
+    }
+    if (first || threshold != lastThreshold) {
+      deltas.appendf(",\"th\":%d", threshold);
+    }
+    deltas.append("}");
+  }
+  lastPercent = sample.percent;
+  lastFlags = sample.flags;
+  lastThreshold = threshold;
+}
+
+static void closeBatch() {
+  char storage[halStorageBlobBytes];
+  TextBuffer out(storage, sizeof(storage));
+  out.appendf("{\"seq\":%u,\"from\":%u,\"to\":%u,\"samples\":%u,\"min\":%u,\"max\":%u,"
+              "\"avg\":%u,",
+              (unsigned)++sequence, (unsigned)batchStartMs, (unsigned)batchEndMs,
+              (unsigned)batchSamples, batchMin, batchMax, (unsigned)(batchSum / batchSamples));
+  if (batchTruncated) {
+    out.appendf("\"truncated\":%u,", (unsigned)batchTruncated);
+  }
+  out.append("\"deltas\":[");
+  out.append(deltas.c_str());
+  out.append("]}");
+  stats.batches++;
+
+  deltas.clear();
+  batchSamples = 0;
+  batchSum = 0;
+  batchTruncated = 0;
+
+  // Newer than anything queued, so it may only jump the queue if it's empty
+  if (!pending && queueHead == queueTail) {
+    memcpy(message, storage, out.length());
+    messageLength = out.length();
+    pending = true;
+    fromQueue = false;
+    sent = false;
+  } else {
+    queuePush(storage, out.length());
+  }
+}
+
+static void linkLost(uint32_t nowMs) {
+  if (sessionUp) {
+    stats.connectedMs += nowMs - sessionStartMs;
+    downSinceMs = nowMs;
+    halPrintf("MQTT: connection lost\n");
+  }
+  sessionUp = false;
+  drainStartMs = 0;
+
+  // A fresh batch that may not have arrived waits in flash with the rest;
+  // a queued one is still there
+  if (pending && !fromQueue) {
+    queuePush(message, messageLength);
+  }
+  pending = false;
+  nextAttemptMs = nowMs + backoffMs;
+  backoffMs = backoffMs * 2 < maxBackoffMs ? backoffMs * 2 : maxBackoffMs;
+}
+
+static void sessionStarted(uint32_t nowMs) {
+  sessionUp = true;
+  sessionStartMs = nowMs;
+  backoffMs = minBackoffMs;
+  uint32_t took = nowMs - downSinceMs;
+  stats.connects++;
+  stats.lastReconnectMs = took;
+  stats.totalReconnectMs += took;
+  if (took > stats.maxReconnectMs) {
+    stats.maxReconnectMs = took;
+  }
+  halPrintf("MQTT: connected to %s:%u in %u ms, %u queued\n", config.host, config.port,
+            (unsigned)took, (unsigned)(queueTail - queueHead));
+
+  mqtt.subscribe(commandTopic, 1);
+  mqtt.publish(statusTopic, "online", 6, 0, true);
+  if (queueHead != queueTail) {
+    drainStartMs = nowMs;
+    drainCount = 0;
+  }
+}
+
+static void messageDone(uint32_t nowMs) {
+  stats.acked++;
+  stats.bytesAcked += messageLength;
+  uint32_t ackMs = nowMs - sentMs;
+  stats.totalAckMs += ackMs;
+  if (ackMs > stats.maxAckMs) {
+    stats.maxAckMs = ackMs;
+  }
+  if (fromQueue) {
+    queuePop();
+    drainCount++;
+    if (drainStartMs && queueHead == queueTail) {
+      stats.drainMessages = drainCount;
+      stats.drainMs = nowMs - drainStartMs;
+      drainStartMs = 0;
+    }
+  }
+  pending = false;
+}
+
+void telemetryPoll(uint32_t nowMs) {
+  if (!enabled) {
+    return;
+  }
+  if (batchSamples && nowMs - batchStartMs >= config.intervalMs) {
+    closeBatch();
+  }
+
+  if (!mqtt.open()) {
+    if (halTcpLinkUp() && (int32_t)(nowMs - nextAttemptMs) >= 0) {
+      stats.attempts++;
+      connectStartMs = nowMs;
+      if (!mqtt.connect(config.host, config.port, config.clientId, keepAliveS, statusTopic,
+                        "offline", connectTimeoutMs)) {
+        linkLost(halMillis());
+      }
+    }
+    return;
+  }
+  if (!mqtt.poll(nowMs)) {
+    linkLost(nowMs);
+    return;
+  }
+  if (!mqtt.connected()) {
+    if (nowMs - connectStartMs > connackTimeoutMs) {
+      mqtt.disconnect();
+      linkLost(nowMs);
+    }
+    return;
+  }
+  if (!sessionUp) {
+    sessionStarted(nowMs);
+  }
+
+  if (pending && sent && mqtt.inflight() == 0) {
+    messageDone(nowMs);
+  }
+  if (!pending && queuePeek()) {
+    pending = true;
+    fromQueue = true;
+    sent = false;
+  }
+  if (pending && !sent) {
+    if (mqtt.publish(telemetryTopic, message, messageLength, config.qos, false)) {
+      sent = true;
+      sentMs = nowMs;
+      stats.published++;
+      if (config.qos == 0) {
+        messageDone(nowMs);
+      }
+    }
+  }
+}
+
+void telemetryJson(TextBuffer& out) {
+  if (!enabled) {
+    out.append("{\"enabled\":false}");
+    return;
+  }
+  uint32_t now = halMillis();
+  uint64_t connectedMs = stats.connectedMs + (sessionUp ? now - sessionStartMs : 0);
+  uint32_t reconnects = stats.connects;
+  out.appendf("{\"enabled\":true,\"broker\":\"%s:%u\",\"connected\":%s,\"qos\":%u,"
+              "\"intervalMs\":%u,\"batches\":%u,\"published\":%u,\"acked\":%u,"
+              "\"bytesAcked\":%llu,\"queueDepth\":%u,\"queued\":%u,\"queueDropped\":%u,"
+              "\"attempts\":%u,\"connects\":%u,\"reconnectMs\":{\"last\":%u,\"max\":%u,"
+              "\"avg\":%u},\"connectedMs\":%llu,\"ackMs\":{\"max\":%u,\"avg\":%u},"
+              "\"throughput\":{\"messagesPerHour\":%u,\"bytesPerSecond\":%u,"
+              "\"drainMessages\":%u,\"drainMs\":%u},\"commands\":%u}",
+              config.host, config.port, sessionUp ? "true" : "false", config.qos,
+              (unsigned)config.intervalMs, (unsigned)stats.batches, (unsigned)stats.published,
+              (unsigned)stats.acked, (unsigned long long)stats.bytesAcked,
+              (unsigned)(queueTail - queueHead), (unsigned)stats.queued,
+              (unsigned)stats.queueDropped, (unsigned)stats.attempts, (unsigned)stats.connects,
+              (unsigned)stats.lastReconnectMs, (unsigned)stats.maxReconnectMs,
+              (unsigned)(reconnects ? stats.totalReconnectMs / reconnects : 0),
+              (unsigned long long)connectedMs, (unsigned)stats.maxAckMs,
+              (unsigned)(stats.acked ? stats.totalAckMs / stats.acked : 0),
+              (unsigned)(connectedMs ? (uint64_t)stats.acked * 3600000 / connectedMs : 0),
+              (unsigned)(connectedMs ? stats.bytesAcked * 1000 / connectedMs : 0),
+              (unsigned)stats.drainMessages, (unsigned)stats.drainMs, (unsigned)stats.commands);
+}
@@ -0,0 +1,56 @@
+#include "text_buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static char emptyText[1] = "";
+
+TextBuffer::TextBuffer(char* data, size_t capacity)
+    : data_(data && capacity ? data : emptyText),
+      capacity_(data && capacity ? capacity : 1),
+      length_(0),
+      overflowed_(!data || !capacity) {
+  data_[0] = '\0';
+}
+
+TextBuffer& TextBuffer::append(const char* text) {
+  size_t room = capacity_ - length_ - 1;
+  size_t len = strlen(text);
+  if (len > room) {
+    len = room;
+    overflowed_ = true;
+  }
+  memcpy(data_ + length_, text, len);
+  length_ += len;
+  data_[length_] = '\0';
+  return *this;
+}
+
+TextBuffer& TextBuffer::appendf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vappendf(format, args);
+  va_end(args);
+  return *this;
+}
+
+TextBuffer& TextBuffer::vappendf(const char* format, va_list args) {
+  size_t room = capacity_ - length_;
+  int written = vsnprintf(data_ + length_, room, format, args);
+  if (written < 0) {
+    overflowed_ = true;
+    data_[length_] = '\0';
+  } else if ((size_t)written >= room) {
+    overflowed_ = true;
+    length_ = capacity_ - 1;
+  } else {
+    length_ += written;
+  }
+  return *this;
+}
+
+void TextBuffer::clear() {
+  length_ = 0;
+  overflowed_ = capacity_ <= 1;
+  data_[0] = '\0';
+}
@@ -0,0 +1,189 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+
+static const uint32_t slotMask = TimerWheel::slots - 1;
+
+static inline int slotIndex(uint32_t expires, int level) {
+  return (expires >> (level * TimerWheel::slotBits)) & slotMask;
+}
+
+static inline bool after(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) > 0;
+}
+
+// Index of the first set bit at or after `from`, wrapping around, or -1
+static inline int nextOccupied(uint64_t bitmap, int from) {
+  if (!bitmap) return -1;
+  uint64_t ahead = bitmap & (~0ULL << from);
+  return __builtin_ctzll(ahead ? ahead : bitmap);
+}
+
+TimerWheel::TimerWheel(uint32_t now) : now_(now), registry_(nullptr) {
+  memset(wheel_, 0, sizeof(wheel_));
+  memset(occupied_, 0, sizeof(occupied_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void TimerWheel::start(WheelTimer& timer, uint32_t delay, uint32_t period) {
+  if (timer.active) {
+    unlink(timer);
+  }
+  if (!timer.registered) {
+    timer.registered = true;
+    timer.registryNext = registry_;
+    registry_ = &timer;
+  }
+  timer.expires = now_ + (delay ? delay : 1);
+  timer.period = period;
+  timer.active = true;
+  insert(timer);
+}
+
+void TimerWheel::stop(WheelTimer& timer) {
+  if (timer.active) {
+    unlink(timer);
+    timer.active = false;
+  }
+}
+
+void TimerWheel::insert(WheelTimer& timer) {
+  // delta is 0 only when cascading into the tick being processed, which
+  // is fired right after the cascade
+  uint32_t delta = timer.expires - now_;
+  if (after(now_, timer.expires)) {
+    timer.expires = now_ + 1;
+    delta = 1;
+  }
+
+  int level = 0;
+  while (level < levels - 1 && delta >= (1u << ((level + 1) * slotBits))) {
+    level++;
+  }
+  // Beyond the top level's reach: park in the furthest slot, re-cascading
+  // recomputes the position each time it comes round
+  uint32_t at = timer.expires;
+  if (level == levels - 1 && delta >= (1u << (levels * slotBits))) {
+    at = now_ + (1u << (levels * slotBits)) - 1;
+  }
+  int slot = slotIndex(at, level);
+
+  WheelTimer*& head = wheel_[level][slot];
+  timer.level = level;
+  timer.slot = slot;
+  timer.prev = nullptr;
+  timer.next = head;
+  if (head) head->prev = &timer;
+  head = &timer;
+  occupied_[level] |= 1ULL << slot;
+}
+
+void TimerWheel::unlink(WheelTimer& timer) {
+  if (timer.prev) {
+    timer.prev->next = timer.next;
+  } else {
+    wheel_[timer.level][timer.slot] = timer.next;
+    if (!timer.next) {
+      occupied_[timer.level] &= ~(1ULL << timer.slot);
+    }
+  }
+  if (timer.next) {
+    timer.next->prev = timer.prev;
+  }
+  timer.next = timer.prev = nullptr;
+}
+
+void TimerWheel::cascade(int level, int slot) {
+  WheelTimer* t = wheel_[level][slot];
+  wheel_[level][slot] = nullptr;
+  occupied_[level] &= ~(1ULL << slot);
+  while (t) {
+    WheelTimer* next = t->next;
+    insert(*t);
+    t = next;
+  }
+}
+
+void TimerWheel::fire(int slot, uint32_t now) {
+  // Pop one at a time: a callback may start or stop any other timer
+  while (WheelTimer* t = wheel_[0][slot]) {
+    unlink(*t);
+
+    uint32_t late = now - t->expires;
+    t->fired++;
+    if (late > t->maxLate) t->maxLate = late;
+    stats_.fired++;
+    stats_.totalLate += late;
+    if (late > 0) stats_.late++;
+    if (late > stats_.maxLate) stats_.maxLate = late;
+
+    if (t->period) {
+      // Keep the phase; a stalled caller gets one callback, not a burst
+      t->expires += t->period;
+      if (!after(t->expires, now)) {
+        t->expires = now + t->period - (now - t->expires) % t->period;
+      }
+      insert(*t);
+    } else {
+      t->active = false;
+    }
+    if (t->callback) {
+      t->callback(t->arg);
+    }
+  }
+}
+
+void TimerWheel::advance(uint32_t now) {
+  while (after(now, now_)) {
+    // Nothing pending at all: jump straight there
+    if (!(occupied_[0] | occupied_[1] | occupied_[2] | occupied_[3])) {
+      now_ = now;
+      return;
+    }
+
+    // Skip empty level-0 slots up to the next cascade boundary
+    uint32_t boundary = (now_ | slotMask) + 1;
+    uint32_t target = after(boundary, now) ? now : boundary;
+    // (slots below `from` belong to the next block)
+    int from = (now_ + 1) & slotMask;
+    uint32_t tick = target;
+    uint64_t ahead = from ? occupied_[0] & (~0ULL << from) : 0;
+    if (ahead) {
+      uint32_t candidate = (now_ & ~slotMask) + __builtin_ctzll(ahead);
+      if (!after(candidate, target)) tick = candidate;
+    }
+    now_ = tick;
+
+    if ((now_ & slotMask) == 0) {
+      // Pull down from the highest level whose block just started
+      int top = 1;
+      while (top < levels - 1 && slotIndex(now_, top) == 0) {
+        top++;
+      }
+      for (int level = top; level >= 1; level--) {
+        cascade(level, slotIndex(now_, level));
+      }
+    }
+
+    if (occupied_[0] & (1ULL << (now_ & slotMask))) {
+      fire(now_ & slotMask, now);
+    }
+  }
+}
+
+uint32_t TimerWheel::ticksUntilNext(uint32_t now, uint32_t limit) const {
+  uint32_t best = limit;
+  for (int level = 0; level < levels; level++) {
+    int from = level == 0 ? (now_ + 1) & slotMask : (slotIndex(now_, level) + 1) & slotMask;
+    int slot = nextOccupied(occupied_[level], from);
+    if (slot < 0) continue;
+    // Timers in earlier slots of a level always expire first, so the
+    // earliest expiry on this level is in its next occupied slot
+    for (WheelTimer* t = wheel_[level][slot]; t; t = t->next) {
+      if (!after(t->expires, now)) return 0;
+      uint32_t wait = t->expires - now;
+      if (wait < best) best = wait;
+    }
+  }
+  return best;
+}
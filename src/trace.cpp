@@ -0,0 +1,111 @@
+#include "trace.h"
+
+#include "hal.h"
+#include "trace_ring.h"
+
+// Linux builds run every task on one thread, recorded as core 0
+#if defined(ESP32)
+#include <Arduino.h>
+static const int coreCount = portNUM_PROCESSORS;
+static inline int currentCore() { return xPortGetCoreID(); }
+#else
+static const int coreCount = 1;
+static inline int currentCore() { return 0; }
+#endif
+
+static TraceRing<512> ring;
+
+// Per core, written only from that core
+static uint32_t lastSyncCycles[coreCount];
+static bool synced[coreCount];
+
+static const char* trackNames[TRACK_COUNT] = { "network", "control", "ui", "isr" };
+
+static void record(TraceTrack track, const char* name, char phase, uint32_t arg) {
+  TraceEvent event;
+  event.cycles = cycleCount();
+  event.name = name;
+  event.arg = arg;
+  event.phase = phase;
+  event.core = currentCore();
+  event.track = track;
+  ring.record(event);
+}
+
+void traceBegin(TraceTrack track, const char* name) {
+  record(track, name, 'B', 0);
+}
+
+void traceEnd(TraceTrack track, const char* name) {
+  record(track, name, 'E', 0);
+}
+
+void traceInstant(TraceTrack track, const char* name) {
+  record(track, name, 'i', 0);
+}
+
+void traceClockSync() {
+  int core = currentCore();
+  uint32_t now = cycleCount();
+  if (synced[core] && now - lastSyncCycles[core] < cyclesPerMicrosecond() * 1000000) {
+    return;
+  }
+  lastSyncCycles[core] = now;
+  synced[core] = true;
+  record(TRACK_COUNT, "clock", 'S', (uint32_t)halMicros());
+}
+
+void traceChromeJson(TextBuffer& chunk, TraceFlush flush) {
+  struct Sync {
+    bool valid;
+    uint32_t cycles;
+    uint32_t us;
+  };
+  Sync sync[coreCount] = {};
+  bool haveBase = false;
+  uint32_t baseUs = 0;
+  uint32_t cpm = cyclesPerMicrosecond();
+
+  chunk.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+               "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"irrigation\"}}");
+  for (int t = 0; t < TRACK_COUNT; t++) {
+    chunk.appendf(",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                  "\"args\":{\"name\":\"%s\"}}", t, trackNames[t]);
+  }
+  flush(chunk);
+
+  uint32_t head = ring.head();
+  uint32_t start = head > ring.capacity() ? head - ring.capacity() : 0;
+  for (uint32_t i = start; i != head; i++) {
+    TraceEvent e;
+    if (!ring.read(i, e)) {
+      continue;
+    }
+    if (e.phase == 'S') {
+      sync[e.core].valid = true;
+      sync[e.core].cycles = e.cycles;
+      sync[e.core].us = e.arg;
+      if (!haveBase) {
+        haveBase = true;
+        baseUs = e.arg;
+      }
+      continue;
+    }
+    const Sync& s = sync[e.core];
+    if (!s.valid) {
+      continue;
+    }
+
+    // Tenths of a microsecond since the first sync; events may precede
+    // their core's sync by a little, hence the signed offset
+    int64_t tenths = (int64_t)(s.us - baseUs) * 10 + (int64_t)(int32_t)(e.cycles - s.cycles) * 10 / cpm;
+    if (tenths < 0) {
+      continue;
+    }
+    chunk.appendf(",{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u.%u,\"pid\":1,\"tid\":%u%s}",
+                  e.name, e.phase, (unsigned)(tenths / 10), (unsigned)(tenths % 10), e.track,
+                  e.phase == 'i' ? ",\"s\":\"t\"" : "");
+    flush(chunk);
+  }
+  chunk.append("]}");
+}
@@ -0,0 +1,76 @@
+#include "water_usage.h"
+
+#include <string.h>
+
+WaterUsage::WaterUsage()
+    : pulsesPerLiter_(450), remainder_(0), closedAt_(0), closing_(false) {
+  memset(&state_, 0, sizeof(state_));
+  state_.sessionZone = -1;
+}
+
+void WaterUsage::begin(uint32_t pulsesPerLiter, const uint32_t* zoneTotalsMl) {
+  pulsesPerLiter_ = pulsesPerLiter ? pulsesPerLiter : 1;
+  for (int z = 0; z < waterZoneCount; z++) {
+    state_.zones[z].totalMl = zoneTotalsMl[z];
+  }
+  published_.write(state_);
+}
+
+void WaterUsage::closeSession() {
+  state_.zones[state_.sessionZone].sessions++;
+  state_.sessions++;
+  state_.sessionZone = -1;
+  closing_ = false;
+}
+
+void WaterUsage::update(uint32_t pulses, uint32_t elapsedMs, int zone, uint32_t nowSeconds) {
+  uint32_t day = nowSeconds / 86400;
+  if (day != state_.day) {
+    state_.day = day;
+    state_.yesterdayMl = state_.todayMl;
+    state_.todayMl = 0;
+    for (int z = 0; z < waterZoneCount; z++) {
+      state_.zones[z].todayMl = 0;
+    }
+  }
+
+  // Convert with the remainder carried over so no fraction of a pulse is lost
+  uint64_t scaled = (uint64_t)pulses * 1000 + remainder_;
+  uint32_t ml = (uint32_t)(scaled / pulsesPerLiter_);
+  remainder_ = (uint32_t)(scaled % pulsesPerLiter_);
+  state_.flowMlPerMin = elapsedMs ? (uint32_t)((uint64_t)ml * 60000 / elapsedMs) : 0;
+
+  // Session bookkeeping
+  if (zone >= 0 && zone != state_.sessionZone) {
+    if (state_.sessionZone >= 0) {
+      closeSession();
+    }
+    state_.sessionZone = zone;
+    state_.sessionMl = 0;
+    state_.sessionSeconds = 0;
+  } else if (zone < 0 && state_.sessionZone >= 0) {
+    if (!closing_) {
+      closing_ = true;
+      closedAt_ = nowSeconds;
+    } else if (nowSeconds - closedAt_ >= sessionTailSeconds || ml == 0) {
+      closeSession();
+    }
+  } else if (zone >= 0) {
+    closing_ = false;
+  }
+
+  state_.todayMl += ml;
+  if (state_.sessionZone >= 0) {
+    ZoneUsage& z = state_.zones[state_.sessionZone];
+    z.totalMl += ml;
+    z.todayMl += ml;
+    state_.sessionMl += ml;
+    if (!closing_) {
+      state_.sessionSeconds += (elapsedMs + 500) / 1000;
+    }
+  } else {
+    state_.unattributedMl += ml;
+  }
+
+  published_.write(state_);
+}